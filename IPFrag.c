@@ -64,16 +64,91 @@
 #error "IPFrag_DataMTUSize MUST BE A FACTOR OF 8"
 #endif
 
+#if IPFrag_CRC_Enable == 1
+#define IPFrag_CRC_SIZE     4
+#define IPFrag_CRC_INIT     0xFFFFFFFF
+#define IPFrag_CRC_RESIDUE  0xB798B438  // CRC of a packet followed by its own CRC
+#if defined(__SSE4_2__)
+#define IPFrag_CRC_HARDWARE 1  // SSE4.2 is targeted by compiler
+#include <nmmintrin.h>
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define IPFrag_CRC_HARDWARE 2  // SSE4.2 is selected at run time if CPU supports it
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define IPFrag_CRC_HARDWARE 3  // ARMv8 CRC is targeted by compiler
+#include <arm_acle.h>
+#else
+#define IPFrag_CRC_HARDWARE 0
+#endif
+#else
+#define IPFrag_CRC_SIZE     0
+#define IPFrag_CRC_INIT     0
+#define IPFrag_CRC_RESIDUE  0
+#endif
+
+#if IPFrag_DIRECT_Enable == 1
+#define IPFrag_RX_POOL_NUMBER   1  // Fragments are copied to packet buffers once received
+#define IPFrag_PACKET_ORDER(x)  PacketPoolOrder[x]
+#if IPFrag_PoolNumber > 32
+#error "IPFrag_PoolNumber MUST BE LESS THAN OR EQUAL TO 32 IN DIRECT MODE"
+#endif
+#else
+#define IPFrag_RX_POOL_NUMBER   IPFrag_PoolNumber
+#define IPFrag_PACKET_ORDER(x)  DataPoolOrder[x]
+#endif
+
+#if IPFrag_COALESCE_Enable == 1
+#if (IPFrag_COALESCE_MessageSize + IPFrag_CRC_SIZE) > (IPFrag_DataMTUSize - 6)
+#error "IPFrag_COALESCE_MessageSize MUST BE LESS THAN OR EQUAL TO IPFrag_DataMTUSize - 6 (- 4 if CRC is enabled)"
+#endif
+#endif
+
 /**
  ** ==================================================================================
  **                          ##### Private Variables #####                               
  ** ==================================================================================
  **/
 
-static uint8_t  DataPool[IPFrag_PoolNumber + 1/*Transmit buffer*/][IPFrag_DataMTUSize] = { 0 };
+static uint8_t  DataPool[IPFrag_RX_POOL_NUMBER + 1/*Transmit buffer*/][IPFrag_DataMTUSize] = { 0 };
+#if IPFrag_DIRECT_Enable == 1
+static uint8_t* PacketPool[IPFrag_DIRECT_PacketNumber] = { 0 };
+static uint16_t PacketPoolID[IPFrag_DIRECT_PacketNumber] = { 0 };
+static uint32_t PacketPoolMask[IPFrag_DIRECT_PacketNumber] = { 0 };    // Received fragments
+static uint32_t PacketPoolSize[IPFrag_DIRECT_PacketNumber] = { 0 };    // 0 until the last fragment is received
+static uint32_t PacketPoolTimeout[IPFrag_DIRECT_PacketNumber] = { 0 };
+static uint32_t PacketPoolOrder[IPFrag_DIRECT_PacketNumber] = { 0 };
+#if IPFrag_CRC_Enable == 1
+static uint32_t PacketPoolCRC[IPFrag_DIRECT_PacketNumber] = { 0 };
+static uint8_t  PacketPoolCRCCount[IPFrag_DIRECT_PacketNumber] = { 0 }; // Fragments in CRC
+#endif
+#else
 static uint16_t DataPoolSize[IPFrag_PoolNumber] = { 0 };
 static bool     DataPoolLastPos[IPFrag_PoolNumber] = { 0 };
 static uint32_t DataPoolTimeout[IPFrag_PoolNumber] = { 0 };
+static uint32_t DataPoolOrder[IPFrag_PoolNumber] = { 0 };      // Set for the slot of last fragment
+#endif
+static uint32_t ReadyOrder = 0; // Completion order of packets and coalesced frames, they are read in this order
+
+#if IPFrag_COALESCE_Enable == 1
+static uint8_t  CoalesceTxPool[IPFrag_DataMTUSize] = { 0 };
+static uint16_t CoalesceTxSize = 0;
+static uint32_t CoalesceTxTick = 0;
+
+/**
+ * @brief  Received coalesced frame waiting to be read record by record
+ */
+typedef struct IPFrag_Coalesced_s
+{
+    struct IPFrag_Coalesced_s*  Next;
+    uint16_t                    Size;
+    uint16_t                    Pos;
+    uint32_t                    Order;
+    uint8_t                     Data[];
+} IPFrag_Coalesced_t;
+
+static IPFrag_Coalesced_t* CoalesceRxHead = NULL;
+static IPFrag_Coalesced_t* CoalesceRxTail = NULL;
+#endif
 
 /**
  *! ==================================================================================
@@ -83,6 +158,558 @@ static uint32_t DataPoolTimeout[IPFrag_PoolNumber] = { 0 };
 
 static uint32_t GetTickTemp(void) { return 0; }
 
+#if IPFrag_CRC_Enable == 1
+#if (IPFrag_CRC_HARDWARE == 0) || (IPFrag_CRC_HARDWARE == 2)
+static uint32_t
+IPFrag_CRC32CTable(uint32_t Crc, const uint8_t* Data, uint32_t Size)
+{
+    static const uint32_t CRCTable[16] =
+    {
+        0x00000000, 0x105EC76F, 0x20BD8EDE, 0x30E349B1, 0x417B1DBC, 0x5125DAD3, 0x61C69362, 0x7198540D,
+        0x82F63B78, 0x92A8FC17, 0xA24BB5A6, 0xB21572C9, 0xC38D26C4, 0xD3D3E1AB, 0xE330A81A, 0xF36E6F75
+    };
+    for (; Size; Size--, Data++)
+    {
+        Crc ^= *Data;
+        Crc = (Crc >> 4) ^ CRCTable[Crc & 0x0F];
+        Crc = (Crc >> 4) ^ CRCTable[Crc & 0x0F];
+    }
+    return Crc;
+}
+#endif
+
+#if (IPFrag_CRC_HARDWARE == 1) || (IPFrag_CRC_HARDWARE == 2)
+#if IPFrag_CRC_HARDWARE == 2
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t
+IPFrag_CRC32CSSE42(uint32_t Crc, const uint8_t* Data, uint32_t Size)
+{
+#if defined(__x86_64__)
+    for (; Size >= 8; Size -= 8, Data += 8)
+    {
+        uint64_t Word;
+        memcpy(&Word, Data, 8);
+        Crc = (uint32_t)_mm_crc32_u64(Crc, Word);
+    }
+#endif
+    for (; Size >= 4; Size -= 4, Data += 4)
+    {
+        uint32_t Word;
+        memcpy(&Word, Data, 4);
+        Crc = _mm_crc32_u32(Crc, Word);
+    }
+    for (; Size; Size--, Data++)
+        Crc = _mm_crc32_u8(Crc, *Data);
+    return Crc;
+}
+#endif
+#endif
+
+/**
+ * @brief  Updates CRC32C (Castagnoli) without final xor
+ * @note   Uses SSE4.2 (checked at run time on GCC/Clang x86 builds) or ARMv8 CRC instructions if available
+ */
+static uint32_t
+IPFrag_CRC32C(uint32_t Crc, const uint8_t* Data, uint32_t Size)
+{
+#if IPFrag_CRC_Enable == 1
+#if IPFrag_CRC_HARDWARE == 1
+    Crc = IPFrag_CRC32CSSE42(Crc, Data, Size);
+#elif IPFrag_CRC_HARDWARE == 2
+    static int8_t Hardware = -1; // CPU is checked once
+    if (Hardware < 0)
+        Hardware = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+    if (Hardware)
+        Crc = IPFrag_CRC32CSSE42(Crc, Data, Size);
+    else
+        Crc = IPFrag_CRC32CTable(Crc, Data, Size);
+#elif IPFrag_CRC_HARDWARE == 3
+#if !defined(__ARM_BIG_ENDIAN) // Words are loaded in little-endian order
+    for (; Size >= 8; Size -= 8, Data += 8)
+    {
+        uint64_t Word;
+        memcpy(&Word, Data, 8);
+        Crc = __crc32cd(Crc, Word);
+    }
+#endif
+    for (; Size; Size--, Data++)
+        Crc = __crc32cb(Crc, *Data);
+#else
+    Crc = IPFrag_CRC32CTable(Crc, Data, Size);
+#endif
+#else
+    (void)Data;
+    (void)Size;
+#endif
+    return Crc;
+}
+
+/**
+ * @brief  Copies a part of packet (data followed by CRC trailer) and updates CRC
+ * @param  Position: Position of the part in the packet
+ * @param  Size:     Size of the part
+ */
+static uint32_t
+IPFrag_CopyPayload(uint8_t* Dest, uint8_t* DataBuff, uint32_t SizeofDataBuff, uint32_t Position, uint32_t Size, uint32_t Crc)
+{
+    uint32_t SizeofData = 0;
+    if (Position < SizeofDataBuff)
+        SizeofData = ((SizeofDataBuff - Position) < Size) ? (SizeofDataBuff - Position) : Size;
+
+    if (SizeofData)
+    {
+        memcpy(Dest, &DataBuff[Position], SizeofData);
+        Crc = IPFrag_CRC32C(Crc, Dest, SizeofData);
+    }
+    for (uint32_t CounterByte = SizeofData; CounterByte < Size; CounterByte++)
+        Dest[CounterByte] = (~Crc) >> (8 * (Position + CounterByte - SizeofDataBuff));
+
+    return Crc;
+}
+
+/**
+ * @brief  Checks and removes CRC trailer of a received packet
+ * @param  Crc: CRC of the whole packet including its trailer
+ * @retval true: Valid | false: CRC error, DataBuff is freed
+ */
+static bool
+IPFrag_CheckCRC(uint8_t** DataBuff, uint32_t* SizeofDataBuff, uint32_t Crc)
+{
+#if IPFrag_CRC_Enable == 1
+    if ((*SizeofDataBuff < IPFrag_CRC_SIZE) || (Crc != IPFrag_CRC_RESIDUE))
+    {
+        PROGRAMLOG("CRC error, The packet is ignored\r\n");
+        free(*DataBuff);
+        *DataBuff = NULL;
+        return false;
+    }
+    *SizeofDataBuff -= IPFrag_CRC_SIZE;
+#else
+    (void)DataBuff;
+    (void)SizeofDataBuff;
+    (void)Crc;
+#endif
+    return true;
+}
+
+#if IPFrag_COALESCE_Enable == 1
+static void
+IPFrag_CoalesceFlush(IPFrag_Handler_t* Handler)
+{
+    if (CoalesceTxSize <= 4) return;
+
+    uint16_t IPVal = 0;
+
+    if (Handler->RandomID)
+        IPVal = Handler->RandomID();
+    else
+        IPVal = (DataPool[IPFrag_RX_POOL_NUMBER][0] << 16) | ((DataPool[IPFrag_RX_POOL_NUMBER][1]) + 1);
+
+    DataPool[IPFrag_RX_POOL_NUMBER][0] = IPVal >> 16;
+    DataPool[IPFrag_RX_POOL_NUMBER][1] = IPVal;
+
+    CoalesceTxPool[0] = IPVal >> 16;
+    CoalesceTxPool[1] = IPVal;
+    CoalesceTxPool[2] = 0xC0; // Reserved (Coalesced): 1 | MF (More Fragments): 0 | DF (Don't Fragment): 1
+    CoalesceTxPool[3] = 0;
+
+    Handler->TransmitData(CoalesceTxPool, CoalesceTxSize);
+
+    CoalesceTxSize = 0;
+}
+
+static void
+IPFrag_CoalesceAppend(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint16_t SizeofDataBuff)
+{
+    uint16_t SizeofRecord = SizeofDataBuff + IPFrag_CRC_SIZE;
+
+    if ((CoalesceTxSize + 2 + SizeofRecord) > IPFrag_DataMTUSize)
+        IPFrag_CoalesceFlush(Handler);
+
+    if (CoalesceTxSize == 0)
+    {
+        CoalesceTxSize = 4;
+        CoalesceTxTick = Handler->GetTick();
+    }
+
+    CoalesceTxPool[CoalesceTxSize] = SizeofRecord >> 8;
+    CoalesceTxPool[CoalesceTxSize + 1] = SizeofRecord;
+    IPFrag_CopyPayload(&CoalesceTxPool[CoalesceTxSize + 2], DataBuff, SizeofDataBuff, 0, SizeofRecord, IPFrag_CRC_INIT);
+    CoalesceTxSize += 2 + SizeofRecord;
+
+    if ((CoalesceTxSize - 4) >= IPFrag_COALESCE_FlushSize)
+        IPFrag_CoalesceFlush(Handler);
+}
+
+/**
+ * @brief  Queues a received coalesced frame to be read record by record
+ * @retval true: Queued | false: Memory error
+ */
+static bool
+IPFrag_CoalesceStore(uint8_t* Data, uint16_t SizeOfData)
+{
+    IPFrag_Coalesced_t* Frame = malloc(sizeof(IPFrag_Coalesced_t) + SizeOfData);
+    if (!Frame)
+    {
+        PROGRAMLOG("Memory allocation error (coalesced frame)\r\n");
+        return false;
+    }
+    Frame->Next = NULL;
+    Frame->Size = SizeOfData;
+    Frame->Pos = 0;
+    Frame->Order = ReadyOrder++;
+    memcpy(Frame->Data, Data, SizeOfData);
+
+    if (CoalesceRxTail)
+        CoalesceRxTail->Next = Frame;
+    else
+        CoalesceRxHead = Frame;
+    CoalesceRxTail = Frame;
+    return true;
+}
+
+static void
+IPFrag_CoalesceRemove(void)
+{
+    IPFrag_Coalesced_t* Frame = CoalesceRxHead;
+    CoalesceRxHead = Frame->Next;
+    if (!CoalesceRxHead)
+        CoalesceRxTail = NULL;
+    free(Frame);
+}
+
+/**
+ * @param  Blocking: Records with CRC error are skipped (blocking mode) instead of being reported
+ * @retval 0: Successful | 1: Memory error | 2: No records | 6: CRC error
+ */
+static uint8_t
+IPFrag_CoalesceRead(uint8_t** DataBuff, uint32_t* SizeofDataBuff, bool Blocking)
+{
+    while (CoalesceRxHead)
+    {
+        IPFrag_Coalesced_t* Frame = CoalesceRxHead;
+        uint16_t RecordSize = 0;
+        if ((Frame->Size - Frame->Pos) >= 2)
+            RecordSize = (Frame->Data[Frame->Pos] << 8) | Frame->Data[Frame->Pos + 1];
+        if ((RecordSize == 0) || ((Frame->Pos + 2 + RecordSize) > Frame->Size))
+        {
+            PROGRAMLOG("Broken coalesced record, The rest of frame is ignored\r\n");
+            IPFrag_CoalesceRemove();
+            continue;
+        }
+
+        *SizeofDataBuff = RecordSize;
+
+        (*DataBuff) = malloc(*SizeofDataBuff);
+        if (!(*DataBuff))
+        {
+            PROGRAMLOG("Memory allocation error (coalesced packet)\r\n");
+            return 1;
+        }
+
+        memcpy(*DataBuff, &Frame->Data[Frame->Pos + 2], RecordSize);
+        uint32_t Crc = IPFrag_CRC32C(IPFrag_CRC_INIT, *DataBuff, RecordSize);
+        Frame->Pos += 2 + RecordSize;
+        if (Frame->Pos >= Frame->Size)
+            IPFrag_CoalesceRemove();
+        if (!IPFrag_CheckCRC(DataBuff, SizeofDataBuff, Crc))
+        {
+            if (Blocking) continue;
+            return 6;
+        }
+        return 0;
+    }
+    return 2;
+}
+#endif
+
+#if IPFrag_DIRECT_Enable == 1
+static uint8_t
+IPFrag_DirectNumber(uint8_t Packet)
+{
+    return (PacketPoolSize[Packet] + (IPFrag_DataMTUSize - 5)) / (IPFrag_DataMTUSize - 4);
+}
+
+static bool
+IPFrag_DirectCompleted(uint8_t Packet)
+{
+    if (!PacketPool[Packet] || !PacketPoolSize[Packet]) return false;
+    return PacketPoolMask[Packet] == (0xFFFFFFFF >> (32 - IPFrag_DirectNumber(Packet)));
+}
+
+static void
+IPFrag_DirectFree(uint8_t Packet)
+{
+    free(PacketPool[Packet]);
+    PacketPool[Packet] = NULL;
+    PacketPoolMask[Packet] = 0;
+    PacketPoolSize[Packet] = 0;
+}
+
+/**
+ * @brief  Receives a frame, in transport memory if ReceiveFrame is initialized, otherwise in DataPool[0]
+ */
+static uint8_t*
+IPFrag_DirectFrame(IPFrag_Handler_t* Handler, uint16_t* SizeOfFrame)
+{
+    uint8_t* Frame = DataPool[0];
+    *SizeOfFrame = 0;
+    if (Handler->ReceiveFrame)
+        Handler->ReceiveFrame(&Frame, SizeOfFrame);
+    else
+        Handler->ReceiveData(Frame, SizeOfFrame);
+    return Frame;
+}
+
+/**
+ * @brief  Copies payload of the received frame to its final offset in the packet buffer
+ * @param  Packet: Index of the packet that the frame belongs to
+ * @retval 0: Packet is completed | 1: Memory error | 4: No completed packets
+ */
+static uint8_t
+IPFrag_DirectPlace(IPFrag_Handler_t* Handler, uint8_t* Frame, uint16_t SizeOfFrame, uint8_t* Packet)
+{
+    if (SizeOfFrame > IPFrag_DataMTUSize)
+    {
+        PROGRAMLOG("The size is more than IPFrag_DataMTUSize! The packet is ignored\r\n");
+        return 4;
+    }
+
+    uint16_t  ID = (Frame[0] << 8) | Frame[1];
+    uint32_t  Offset = (((Frame[2] & 0x1F) << 8) | Frame[3]) * 8;
+    uint8_t   Fragment = Offset / IPFrag_DataMTUSize;
+    uint16_t  SizeOfPayload = SizeOfFrame - 4;
+    bool      Simple = false;
+    bool      Last = false;
+
+    if ((Frame[2] & 0x7F) == 0x40) // MF (More Fragments): 0 | DF (Don't Fragment): 1
+    {
+        if (Offset)
+        {
+            PROGRAMLOG("Simple packet with offset! The packet is ignored\r\n");
+            return 4;
+        }
+        Simple = true;
+        Last = true;
+    }
+    else if ((Frame[2] & 0x60) == 0x20) // MF (More Fragments): 1 | DF (Don't Fragment): 0
+    {
+        Last = false;
+    }
+    else if ((Frame[2] & 0x60) == 0) // MF (More Fragments): 0 | DF (Don't Fragment): 0
+    {
+        Last = true;
+    }
+    else // Wrong Packet
+    {
+        PROGRAMLOG("Wrong packet, The packet is ignored\r\n");
+        return 4;
+    }
+
+    if ((Offset % IPFrag_DataMTUSize) || (Offset >= (IPFrag_PoolNumber * IPFrag_DataMTUSize)))
+    {
+        PROGRAMLOG("Packet with invalid offset, The packet is ignored\r\n");
+        return 4;
+    }
+
+    uint32_t Tick = Handler->GetTick();
+    uint8_t  FreePacket = IPFrag_DIRECT_PacketNumber;
+    uint8_t  OldestPacket = IPFrag_DIRECT_PacketNumber;
+    *Packet = IPFrag_DIRECT_PacketNumber;
+    for (uint8_t CounterP = 0; CounterP < IPFrag_DIRECT_PacketNumber; CounterP++)
+    {
+        if (PacketPool[CounterP] && !IPFrag_DirectCompleted(CounterP) && ((Tick - PacketPoolTimeout[CounterP]) > Handler->ReceiveTimeout))
+            IPFrag_DirectFree(CounterP);
+        if (!PacketPool[CounterP])
+        {
+            if (FreePacket == IPFrag_DIRECT_PacketNumber)
+                FreePacket = CounterP;
+            continue;
+        }
+        if (IPFrag_DirectCompleted(CounterP))
+            continue;
+        if (!Simple && (PacketPoolID[CounterP] == ID))
+            *Packet = CounterP;
+        if ((OldestPacket == IPFrag_DIRECT_PacketNumber) || ((Tick - PacketPoolTimeout[CounterP]) > (Tick - PacketPoolTimeout[OldestPacket])))
+            OldestPacket = CounterP;
+    }
+
+    if (!Last && (SizeOfPayload != (IPFrag_DataMTUSize - 4)))
+    {
+        PROGRAMLOG("First or middle Packet with offset that is not equal to IPFrag_DataMTUSize, The packet is ignored\r\n");
+        if (*Packet != IPFrag_DIRECT_PacketNumber)
+            IPFrag_DirectFree(*Packet);
+        return 4;
+    }
+
+    if (*Packet == IPFrag_DIRECT_PacketNumber)
+    {
+        if (FreePacket == IPFrag_DIRECT_PacketNumber)
+        {
+            PROGRAMLOG("Pool is Full!\r\n");
+            if (OldestPacket == IPFrag_DIRECT_PacketNumber)
+                return 4;
+            IPFrag_DirectFree(OldestPacket);
+            FreePacket = OldestPacket;
+        }
+        *Packet = FreePacket;
+        PacketPoolID[*Packet] = ID;
+        PacketPoolTimeout[*Packet] = Tick;
+#if IPFrag_CRC_Enable == 1
+        PacketPoolCRC[*Packet] = IPFrag_CRC_INIT;
+        PacketPoolCRCCount[*Packet] = 0;
+#endif
+    }
+
+    if (PacketPoolMask[*Packet] & (1UL << Fragment))
+    {
+        PROGRAMLOG("Repeated packet, The packet is ignored\r\n");
+        return 4;
+    }
+    if (Last)
+    {
+        if (PacketPoolSize[*Packet] || (PacketPoolMask[*Packet] >> Fragment))
+        {
+            PROGRAMLOG("Last packet does not match other packets, The packet is ignored\r\n");
+            IPFrag_DirectFree(*Packet);
+            return 4;
+        }
+        PacketPoolSize[*Packet] = (Fragment * (IPFrag_DataMTUSize - 4)) + SizeOfPayload;
+    }
+    else if (PacketPoolSize[*Packet] && (Fragment >= (IPFrag_DirectNumber(*Packet) - 1)))
+    {
+        PROGRAMLOG("Packet after the last packet, The packet is ignored\r\n");
+        return 4;
+    }
+
+    if (!PacketPool[*Packet])
+    {
+        // Allocated once, so placed fragments are never copied again
+        uint32_t SizeOfBuffer = IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4);
+        if (Last) // The size is known
+            SizeOfBuffer = PacketPoolSize[*Packet];
+
+        PacketPool[*Packet] = malloc(SizeOfBuffer);
+        if (!PacketPool[*Packet])
+        {
+            PROGRAMLOG("Memory allocation error (direct packet)\r\n");
+            IPFrag_DirectFree(*Packet);
+            return 1;
+        }
+    }
+
+    memcpy(&PacketPool[*Packet][Fragment * (IPFrag_DataMTUSize - 4)], &Frame[4], SizeOfPayload);
+    PacketPoolMask[*Packet] |= 1UL << Fragment;
+
+#if IPFrag_CRC_Enable == 1
+    // CRC follows the packet while its fragments are received in order
+    while ((PacketPoolCRCCount[*Packet] < IPFrag_PoolNumber) && (PacketPoolMask[*Packet] & (1UL << PacketPoolCRCCount[*Packet])))
+    {
+        uint8_t  CounterF = PacketPoolCRCCount[*Packet];
+        uint32_t SizeOfFragment = IPFrag_DataMTUSize - 4;
+        if (PacketPoolSize[*Packet] && (CounterF == (IPFrag_DirectNumber(*Packet) - 1)))
+            SizeOfFragment = PacketPoolSize[*Packet] - (CounterF * (IPFrag_DataMTUSize - 4));
+        PacketPoolCRC[*Packet] = IPFrag_CRC32C(PacketPoolCRC[*Packet], &PacketPool[*Packet][CounterF * (IPFrag_DataMTUSize - 4)], SizeOfFragment);
+        PacketPoolCRCCount[*Packet]++;
+    }
+#endif
+
+    if (IPFrag_DirectCompleted(*Packet))
+    {
+        PacketPoolOrder[*Packet] = ReadyOrder++;
+        return 0;
+    }
+    return 4;
+}
+
+/**
+ * @brief  Hands buffer of a completed packet to user
+ * @retval 0: Successful | 6: CRC error
+ */
+static uint8_t
+IPFrag_DirectRead(uint8_t Packet, uint8_t** DataBuff, uint32_t* SizeofDataBuff)
+{
+    *SizeofDataBuff = PacketPoolSize[Packet];
+    (*DataBuff) = PacketPool[Packet]; // May be larger than the packet, it is not shrunk to avoid another copy
+    PacketPool[Packet] = NULL;
+
+#if IPFrag_CRC_Enable == 1
+    uint32_t Crc = PacketPoolCRC[Packet];
+#else
+    uint32_t Crc = IPFrag_CRC_INIT;
+#endif
+    IPFrag_DirectFree(Packet);
+    if (!IPFrag_CheckCRC(DataBuff, SizeofDataBuff, Crc))
+        return 6;
+    return 0;
+}
+#endif
+
+#if IPFrag_DIRECT_Enable == 0
+/**
+ * @brief  Checks if all fragments of the packet are received
+ * @param  Slot: Slot of the last fragment (or the simple packet)
+ */
+static bool
+IPFrag_PoolCompleted(uint8_t Slot)
+{
+    if (!DataPoolSize[Slot] || !DataPoolLastPos[Slot]) return false;
+
+    uint8_t NumberOfPacket = (((((DataPool[Slot][2] & 0x1F) << 8) | DataPool[Slot][3]) * 8) / IPFrag_DataMTUSize) + 1;
+    uint8_t PacketC = 0;
+    for (uint8_t CounterPP = 0; CounterPP < IPFrag_PoolNumber; CounterPP++)
+    {
+        if (DataPoolSize[CounterPP] > 0)
+        {
+            if (((DataPool[CounterPP][0] >> 16) | DataPool[CounterPP][1]) == ((DataPool[Slot][0] >> 16) | DataPool[Slot][1]))
+            {
+                PacketC++;
+            }
+        }
+    }
+    return NumberOfPacket == PacketC;
+}
+#endif
+
+/**
+ * @brief  Finds the completed packet that was completed first
+ * @retval Index of packet (slot of its last fragment in pool mode) | 0xFF: No completed packets
+ */
+static uint8_t
+IPFrag_PacketNext(void)
+{
+    uint8_t Packet = 0xFF;
+#if IPFrag_DIRECT_Enable == 1
+    for (uint8_t CounterP = 0; CounterP < IPFrag_DIRECT_PacketNumber; CounterP++)
+    {
+        if (IPFrag_DirectCompleted(CounterP) &&
+            ((Packet == 0xFF) || ((int32_t)(IPFrag_PACKET_ORDER(CounterP) - IPFrag_PACKET_ORDER(Packet)) < 0)))
+            Packet = CounterP;
+    }
+#else
+    for (uint8_t CounterP = 0; CounterP < IPFrag_PoolNumber; CounterP++)
+    {
+        if (IPFrag_PoolCompleted(CounterP) &&
+            ((Packet == 0xFF) || ((int32_t)(IPFrag_PACKET_ORDER(CounterP) - IPFrag_PACKET_ORDER(Packet)) < 0)))
+            Packet = CounterP;
+    }
+#endif
+    return Packet;
+}
+
+/**
+ * @brief  Checks if any completed packet is waiting to be read
+ */
+static bool
+IPFrag_PacketReady(void)
+{
+#if IPFrag_COALESCE_Enable == 1
+    if (CoalesceRxHead) return true;
+#endif
+    return IPFrag_PacketNext() != 0xFF;
+}
+
 /**
  ** ==================================================================================
  **                           ##### Public Functions #####                               
@@ -99,6 +726,7 @@ static uint32_t GetTickTemp(void) { return 0; }
  *          1: ---
  *          2: ---
  *          3: Invalid input pointer
+ *          4: Data is larger than IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4) (- 4 if CRC is enabled)
  */
 uint8_t
 IPFrag_TransmitData(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint32_t SizeofDataBuff)
@@ -106,55 +734,70 @@ IPFrag_TransmitData(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint32_t Sizeo
     if (!Handler) return 3;
     if (!Handler->TransmitData) return 3;
     if (!DataBuff) return 3;
+    if ((SizeofDataBuff + IPFrag_CRC_SIZE) > (IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4))) return 4;
+    if (!Handler->GetTick) Handler->GetTick = GetTickTemp;
+
+#if IPFrag_COALESCE_Enable == 1
+    // Without GetTick the flush time never passes, so messages are sent immediately
+    if ((Handler->GetTick != GetTickTemp) && SizeofDataBuff && (SizeofDataBuff <= IPFrag_COALESCE_MessageSize))
+    {
+        IPFrag_CoalesceAppend(Handler, DataBuff, SizeofDataBuff);
+        return IPFrag_TransmitPoll(Handler);
+    }
+    IPFrag_CoalesceFlush(Handler); // Keeps the order of messages
+#endif
 
     uint16_t IPVal = 0;
     
     if (Handler->RandomID)
         IPVal = Handler->RandomID();
     else
-        IPVal = (DataPool[IPFrag_PoolNumber][0] << 16) | (DataPool[IPFrag_PoolNumber][1]) + 1;
+        IPVal = (DataPool[IPFrag_RX_POOL_NUMBER][0] << 16) | (DataPool[IPFrag_RX_POOL_NUMBER][1]) + 1;
+
+    DataPool[IPFrag_RX_POOL_NUMBER][0] = IPVal >> 16;
+    DataPool[IPFrag_RX_POOL_NUMBER][1] = IPVal;
 
-    DataPool[IPFrag_PoolNumber][0] = IPVal >> 16;
-    DataPool[IPFrag_PoolNumber][1] = IPVal;
+    memset(DataPool[IPFrag_RX_POOL_NUMBER] + 2, 0, IPFrag_DataMTUSize - 2);
 
-    memset(DataPool[IPFrag_PoolNumber] + 2, 0, IPFrag_DataMTUSize - 2);
+    uint32_t SizeofPacket = SizeofDataBuff + IPFrag_CRC_SIZE;
+    uint32_t Crc = IPFrag_CRC_INIT;
 
-    if (SizeofDataBuff > (IPFrag_DataMTUSize - 4))
+    if (SizeofPacket > (IPFrag_DataMTUSize - 4))
     {
         uint16_t CounterBuffer = 0;
 
-        DataPool[IPFrag_PoolNumber][2] = 0x20; // MF (More Fragments): 1 | DF (Don't Fragment): 0
-        DataPool[IPFrag_PoolNumber][3] = 0;  
+        DataPool[IPFrag_RX_POOL_NUMBER][2] = 0x20; // MF (More Fragments): 1 | DF (Don't Fragment): 0
+        DataPool[IPFrag_RX_POOL_NUMBER][3] = 0;  
 
         do
         {
-            memcpy(DataPool[IPFrag_PoolNumber] + 4, &DataBuff[(IPFrag_DataMTUSize - 4) * CounterBuffer], IPFrag_DataMTUSize - 4);
+            Crc = IPFrag_CopyPayload(DataPool[IPFrag_RX_POOL_NUMBER] + 4, DataBuff, SizeofDataBuff, (IPFrag_DataMTUSize - 4) * CounterBuffer, IPFrag_DataMTUSize - 4, Crc);
             
-            Handler->TransmitData(DataPool[IPFrag_PoolNumber], IPFrag_DataMTUSize);
+            Handler->TransmitData(DataPool[IPFrag_RX_POOL_NUMBER], IPFrag_DataMTUSize);
 
             if (Handler->Delay) Delay(1);
                     
             CounterBuffer++;
-            DataPool[IPFrag_PoolNumber][2] = 0x20 | (((IPFrag_DataMTUSize * CounterBuffer / 8) >> 8) & 0x1F); // MF (More Fragments): 1 | DF (Don't Fragment): 0
-            DataPool[IPFrag_PoolNumber][3] = IPFrag_DataMTUSize * CounterBuffer / 8;  
+            DataPool[IPFrag_RX_POOL_NUMBER][2] = 0x20 | (((IPFrag_DataMTUSize * CounterBuffer / 8) >> 8) & 0x1F); // MF (More Fragments): 1 | DF (Don't Fragment): 0
+            DataPool[IPFrag_RX_POOL_NUMBER][3] = IPFrag_DataMTUSize * CounterBuffer / 8;  
             
-            SizeofDataBuff -= (IPFrag_DataMTUSize - 4);
+            SizeofPacket -= (IPFrag_DataMTUSize - 4);
         
-        } while (SizeofDataBuff > (IPFrag_DataMTUSize - 4));
+        } while (SizeofPacket > (IPFrag_DataMTUSize - 4));
 
-        DataPool[IPFrag_PoolNumber][2] = ((IPFrag_DataMTUSize * CounterBuffer / 8) >> 8) & 0x1F; // MF (More Fragments): 0 | DF (Don't Fragment): 0
-        memcpy(DataPool[IPFrag_PoolNumber] + 4, &DataBuff[(IPFrag_DataMTUSize - 4) * CounterBuffer], SizeofDataBuff);
+        DataPool[IPFrag_RX_POOL_NUMBER][2] = ((IPFrag_DataMTUSize * CounterBuffer / 8) >> 8) & 0x1F; // MF (More Fragments): 0 | DF (Don't Fragment): 0
+        IPFrag_CopyPayload(DataPool[IPFrag_RX_POOL_NUMBER] + 4, DataBuff, SizeofDataBuff, (IPFrag_DataMTUSize - 4) * CounterBuffer, SizeofPacket, Crc);
 
-        Handler->TransmitData(DataPool[IPFrag_PoolNumber], SizeofDataBuff + 4);
+        Handler->TransmitData(DataPool[IPFrag_RX_POOL_NUMBER], SizeofPacket + 4);
     }
     else
     {
-        DataPool[IPFrag_PoolNumber][2] = 0x40; // MF (More Fragments): 0 | DF (Don't Fragment): 1
-        DataPool[IPFrag_PoolNumber][3] = 0;
+        DataPool[IPFrag_RX_POOL_NUMBER][2] = 0x40; // MF (More Fragments): 0 | DF (Don't Fragment): 1
+        DataPool[IPFrag_RX_POOL_NUMBER][3] = 0;
     
-        memcpy(DataPool[IPFrag_PoolNumber] + 4, DataBuff, SizeofDataBuff);
+        IPFrag_CopyPayload(DataPool[IPFrag_RX_POOL_NUMBER] + 4, DataBuff, SizeofDataBuff, 0, SizeofPacket, Crc);
 
-        Handler->TransmitData(DataPool[IPFrag_PoolNumber], SizeofDataBuff + 4);
+        Handler->TransmitData(DataPool[IPFrag_RX_POOL_NUMBER], SizeofPacket + 4);
     }
 
     return 0;
@@ -170,6 +813,7 @@ IPFrag_TransmitData(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint32_t Sizeo
  *  @param  SizeofDataBuff  Pointer of size of data to receive
  *  @param  Timeout         Maximum time to be kept in this function
  *          @note           If user does not initialize delay in handler, this parameters treats as number of tries.
+ *          @note           Packets with CRC error are ignored.
  *  @return 0: Successful
  *          1: Memory error
  *          2: Timeout error
@@ -187,6 +831,41 @@ IPFrag_ReceiveData(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
     uint32_t TimeoutCounter = 0;
     do
     {
+#if IPFrag_COALESCE_Enable == 1
+        uint8_t CoalesceResult = IPFrag_CoalesceRead(DataBuff, SizeofDataBuff, true);
+        if (CoalesceResult != 2) return CoalesceResult;
+#endif
+#if IPFrag_DIRECT_Enable == 1
+        uint16_t SizeOfFrame = 0;
+        uint8_t* Frame = IPFrag_DirectFrame(Handler, &SizeOfFrame);
+        if (SizeOfFrame < 5)
+        {
+            PROGRAMLOG("The size is less than 5 bytes!\r\n");
+            continue;
+        }
+
+#if IPFrag_COALESCE_Enable == 1
+        if ((Frame[2] & 0xE0) == 0xC0) // Reserved (Coalesced): 1 | MF (More Fragments): 0 | DF (Don't Fragment): 1
+        {
+            if (Frame[3] == 0)
+            {
+                if (!IPFrag_CoalesceStore(&Frame[4], SizeOfFrame - 4)) return 1;
+                CoalesceResult = IPFrag_CoalesceRead(DataBuff, SizeofDataBuff, true);
+                if (CoalesceResult != 2) return CoalesceResult;
+            }
+            else
+            {
+                PROGRAMLOG("Coalesced packet with offset! The packet is ignored\r\n");
+            }
+            continue;
+        }
+#endif
+
+        uint8_t Packet = 0;
+        uint8_t Result = IPFrag_DirectPlace(Handler, Frame, SizeOfFrame, &Packet);
+        if (Result == 1) return 1;
+        if ((Result == 0) && (IPFrag_DirectRead(Packet, DataBuff, SizeofDataBuff) == 0)) return 0;
+#else
         uint8_t CounterPacket = 0;
         bool FullPool = true;
         for (CounterPacket = 0; CounterPacket < IPFrag_PoolNumber; CounterPacket++)
@@ -229,6 +908,25 @@ IPFrag_ReceiveData(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
             continue;
         }
 
+#if IPFrag_COALESCE_Enable == 1
+        if ((DataPool[CounterPacket][2] & 0xE0) == 0xC0) // Reserved (Coalesced): 1 | MF (More Fragments): 0 | DF (Don't Fragment): 1
+        {
+            if (DataPool[CounterPacket][3] == 0)
+            {
+                bool Stored = IPFrag_CoalesceStore(&DataPool[CounterPacket][4], DataPoolSize[CounterPacket]);
+                DataPoolSize[CounterPacket] = 0;
+                if (!Stored) return 1;
+                CoalesceResult = IPFrag_CoalesceRead(DataBuff, SizeofDataBuff, true);
+                if (CoalesceResult != 2) return CoalesceResult;
+            }
+            else
+            {
+                PROGRAMLOG("Coalesced packet with offset! The packet is ignored\r\n");
+                DataPoolSize[CounterPacket] = 0;
+            }
+        }
+        else
+#endif
         if ((DataPool[CounterPacket][2] & 0x7F) == 0x40) // MF (More Fragments): 0 | DF (Don't Fragment): 1
         {
             if (DataPool[CounterPacket][3] == 0)
@@ -243,8 +941,11 @@ IPFrag_ReceiveData(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
                 }
 
                 memcpy(*DataBuff, &DataPool[CounterPacket][4], *SizeofDataBuff);
+                uint32_t Crc = IPFrag_CRC32C(IPFrag_CRC_INIT, *DataBuff, *SizeofDataBuff);
 
                 DataPoolSize[CounterPacket] = 0;
+                if (!IPFrag_CheckCRC(DataBuff, SizeofDataBuff, Crc))
+                    continue;
                 return 0;
             }
             else
@@ -299,18 +1000,21 @@ IPFrag_ReceiveData(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
                                     return 1;
                                 }
 
+                                uint32_t Crc = IPFrag_CRC_INIT;
                                 uint8_t CounterOffset = 0;
                                 for (uint8_t CounterPP = 0; CounterPP < IPFrag_PoolNumber; CounterPP++)
                                 {
                                     if (((((DataPool[CounterPP][2] & 0x1F) << 8) | DataPool[CounterPP][3]) * 8) == (CounterOffset * IPFrag_DataMTUSize))
                                     {
                                         memcpy(&(*DataBuff)[CounterOffset * (IPFrag_DataMTUSize - 4)], &DataPool[CounterPP][4], DataPoolSize[CounterPP]);
+                                        Crc = IPFrag_CRC32C(Crc, &(*DataBuff)[CounterOffset * (IPFrag_DataMTUSize - 4)], DataPoolSize[CounterPP]);
                                         CounterOffset++;
                                         DataPoolSize[CounterPP] = 0;
                                     }
                                 }
                                 DataPoolLastPos[CounterP] = false;
-                                return 0;
+                                if (IPFrag_CheckCRC(DataBuff, SizeofDataBuff, Crc))
+                                    return 0;
                             }
                             break;
                         }
@@ -345,18 +1049,21 @@ IPFrag_ReceiveData(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
                     return 1;
                 }
 
+                uint32_t Crc = IPFrag_CRC_INIT;
                 uint8_t CounterOffset = 0;
                 for (uint8_t CounterPP = 0; CounterPP < IPFrag_PoolNumber; CounterPP++)
                 {
                     if (((((DataPool[CounterPP][2] & 0x1F) << 8) | DataPool[CounterPP][3]) * 8) == (CounterOffset * IPFrag_DataMTUSize))
                     {
                         memcpy(&(*DataBuff)[CounterOffset * (IPFrag_DataMTUSize - 4)], &DataPool[CounterPP][4], DataPoolSize[CounterPP]);
+                        Crc = IPFrag_CRC32C(Crc, &(*DataBuff)[CounterOffset * (IPFrag_DataMTUSize - 4)], DataPoolSize[CounterPP]);
                         CounterOffset++;
                         DataPoolSize[CounterPP] = 0;
                     }
                 }
                 DataPoolLastPos[CounterPacket] = false;
-                return 0;
+                if (IPFrag_CheckCRC(DataBuff, SizeofDataBuff, Crc))
+                    return 0;
             }
         }
         else // Wrong Packet
@@ -364,6 +1071,7 @@ IPFrag_ReceiveData(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
             PROGRAMLOG("Wrong packet, The packet is ignored\r\n");
             DataPoolSize[CounterPacket] = 0;
         }
+#endif
 
         if (Handler->Delay) 
           Delay(1);
@@ -388,6 +1096,38 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
     if (!Handler->ReceiveData) return 3;
     if (!Handler->GetTick) Handler->GetTick = GetTickTemp;
 
+#if IPFrag_DIRECT_Enable == 1
+    uint16_t SizeOfFrame = 0;
+    uint8_t* Frame = IPFrag_DirectFrame(Handler, &SizeOfFrame);
+    if (SizeOfFrame < 5)
+    {
+        PROGRAMLOG("The size is less than 5 bytes!\r\n");
+        return 4;
+    }
+
+#if IPFrag_COALESCE_Enable == 1
+    if ((Frame[2] & 0xE0) == 0xC0) // Reserved (Coalesced): 1 | MF (More Fragments): 0 | DF (Don't Fragment): 1
+    {
+        if (Frame[3] == 0)
+        {
+            if (!IPFrag_CoalesceStore(&Frame[4], SizeOfFrame - 4)) return 1;
+            Handler->DataReady = true;
+            return 0;
+        }
+        else
+        {
+            PROGRAMLOG("Coalesced packet with offset! The packet is ignored\r\n");
+        }
+        return 4;
+    }
+#endif
+
+    uint8_t Packet = 0;
+    uint8_t Result = IPFrag_DirectPlace(Handler, Frame, SizeOfFrame, &Packet);
+    if (Result == 0)
+        Handler->DataReady = true;
+    return Result;
+#else
     uint8_t CounterPacket = 0;
     bool FullPool = true;
     for (CounterPacket = 0; CounterPacket < IPFrag_PoolNumber; CounterPacket++)
@@ -398,14 +1138,14 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
         {
             DataPoolTimeout[CounterPacket] = Handler->GetTick();
             Handler->ReceiveData(DataPool[CounterPacket], &DataPoolSize[CounterPacket]);
-            if (DataPoolSize[CounterPacket] < 5)
+            if (DataPoolSize[CounterPacket] < 5) // Nothing received
             {
                 PROGRAMLOG("The size is less than 5 bytes!\r\n");
                 DataPoolSize[CounterPacket] = 0;
-                CounterPacket--;
-                continue;
+                return 4;
             }
             DataPoolSize[CounterPacket] -= 4;
+            DataPoolLastPos[CounterPacket] = false; // The slot may be left by a timed out packet
             // PROGRAMLOG("New Packet Received | Size: %u | CP: %u\r\n", DataPoolSize[CounterPacket] + 4, CounterPacket);
             FullPool = false;
             break;
@@ -416,9 +1156,13 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
         PROGRAMLOG("Pool is Full!\r\n");
         uint16_t DataPoolTempSize = 0;
         uint8_t* DataPoolTemp = malloc(IPFrag_DataMTUSize);
-        if (!DataPoolTemp) return IPFrag_CallbackReceive(Handler);
+        if (!DataPoolTemp) return 1;
         Handler->ReceiveData(DataPoolTemp, &DataPoolTempSize);
-        if (DataPoolTempSize < 5) return IPFrag_CallbackReceive(Handler);
+        if (DataPoolTempSize < 5)
+        {
+            free(DataPoolTemp);
+            return 4;
+        }
         for (uint8_t CounterP = 0; CounterP < IPFrag_PoolNumber; CounterP++)
         {
             if (((DataPool[CounterP][0] >> 16) | DataPool[CounterP][1]) == ((DataPoolTemp[0] >> 16) | DataPoolTemp[1]))
@@ -430,10 +1174,31 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
         return IPFrag_CallbackReceive(Handler);
     }
 
+#if IPFrag_COALESCE_Enable == 1
+    if ((DataPool[CounterPacket][2] & 0xE0) == 0xC0) // Reserved (Coalesced): 1 | MF (More Fragments): 0 | DF (Don't Fragment): 1
+    {
+        if (DataPool[CounterPacket][3] == 0)
+        {
+            bool Stored = IPFrag_CoalesceStore(&DataPool[CounterPacket][4], DataPoolSize[CounterPacket]);
+            DataPoolSize[CounterPacket] = 0;
+            if (!Stored) return 1;
+            Handler->DataReady = true;
+            return 0;
+        }
+        else
+        {
+            PROGRAMLOG("Coalesced packet with offset! The packet is ignored\r\n");
+            DataPoolSize[CounterPacket] = 0;
+        }
+    }
+    else
+#endif
     if ((DataPool[CounterPacket][2] & 0x7F) == 0x40) // MF (More Fragments): 0 | DF (Don't Fragment): 1
     {
         if (DataPool[CounterPacket][3] == 0)
         {
+            DataPoolLastPos[CounterPacket] = true; // A simple packet is its own last fragment
+            DataPoolOrder[CounterPacket] = ReadyOrder++;
             Handler->DataReady = true;
             return 0;
         }
@@ -478,6 +1243,7 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
                         }
                         if (NumberOfPacket == PacketC)
                         {
+                            DataPoolOrder[CounterP] = ReadyOrder++;
                             Handler->DataReady = true;
                             return 0;
                         }
@@ -505,6 +1271,7 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
 
         if (NumberOfPacket == PacketC)
         {
+            DataPoolOrder[CounterPacket] = ReadyOrder++;
             Handler->DataReady = true;
             return 0;
         }
@@ -517,9 +1284,12 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
 
     // if (Handler->Delay) Delay(1);
     return 4;
+#endif
 }
 /**
  *  @brief                  Reading received data
+ *  @note                   Completed packets and coalesced messages are read in the order they were completed,
+ *                          Call it until DataReady is false
  *  @param  Handler         Pointer of library handler
  *  @param  DataBuff        Pointer of pointer of data to receive
  *          @note           In this function pointer of data will be malloced, 
@@ -532,6 +1302,7 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler)
  *          3: Invalid input pointer
  *          4: ---
  *          5: Data is not ready to read, recall the function.
+ *          6: CRC error, the packet is ignored
  */
 uint8_t
 IPFrag_ReadReceive(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* SizeofDataBuff)
@@ -542,51 +1313,129 @@ IPFrag_ReadReceive(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
         if (!DataBuff) return 3;
         if (!SizeofDataBuff) return 3;
 
-        uint32_t CounterPacket = 0;
-        for (uint8_t CounterP = 0; CounterP < IPFrag_PoolNumber; CounterP++)
-        {
-            if (DataPoolLastPos[CounterP])
-                CounterPacket = CounterP;
-        }
-
-        uint8_t NumberOfPacket = (((((DataPool[CounterPacket][2] & 0x1F) << 8) | DataPool[CounterPacket][3]) * 8) / IPFrag_DataMTUSize) + 1;
-        uint8_t PacketC = 0;
-        for (uint8_t CounterPP = 0; CounterPP < IPFrag_PoolNumber; CounterPP++)
+        uint8_t Packet = IPFrag_PacketNext();
+#if IPFrag_COALESCE_Enable == 1
+        // Coalesced frames and packets are read in the order they were completed
+        if (CoalesceRxHead && ((Packet == 0xFF) || ((int32_t)(CoalesceRxHead->Order - IPFrag_PACKET_ORDER(Packet)) < 0)))
         {
-            if (DataPoolSize[CounterPP] > 0)
+            uint8_t CoalesceResult = IPFrag_CoalesceRead(DataBuff, SizeofDataBuff, false);
+            if (CoalesceResult != 2)
             {
-                if (((DataPool[CounterPP][0] >> 16) | DataPool[CounterPP][1]) == ((DataPool[CounterPacket][0] >> 16) | DataPool[CounterPacket][1]))
-                {
-                    PacketC++;
-                }
+                Handler->DataReady = IPFrag_PacketReady();
+                return CoalesceResult;
             }
+            Packet = IPFrag_PacketNext();
         }
-
-        if (NumberOfPacket == PacketC)
+#endif
+        if (Packet == 0xFF)
         {
-            *SizeofDataBuff = ((IPFrag_DataMTUSize - 4) * (PacketC - 1)) + DataPoolSize[CounterPacket];
+            Handler->DataReady = false;
+            return 5;
+        }
 
-            (*DataBuff) = malloc(*SizeofDataBuff);
-            if (!(*DataBuff))
-            {
-                PROGRAMLOG("Memory allocation error\r\n");
-                return 1;
-            }
+#if IPFrag_DIRECT_Enable == 1
+        uint8_t Result = IPFrag_DirectRead(Packet, DataBuff, SizeofDataBuff);
+        Handler->DataReady = IPFrag_PacketReady();
+        return Result;
+#else
+        uint8_t NumberOfPacket = (((((DataPool[Packet][2] & 0x1F) << 8) | DataPool[Packet][3]) * 8) / IPFrag_DataMTUSize) + 1;
+        *SizeofDataBuff = ((IPFrag_DataMTUSize - 4) * (NumberOfPacket - 1)) + DataPoolSize[Packet];
 
-            uint8_t CounterOffset = 0;
+        (*DataBuff) = malloc(*SizeofDataBuff);
+        if (!(*DataBuff))
+        {
+            PROGRAMLOG("Memory allocation error\r\n");
+            return 1;
+        }
+
+        uint32_t Crc = IPFrag_CRC_INIT;
+        for (uint8_t CounterOffset = 0; CounterOffset < NumberOfPacket; CounterOffset++)
+        {
             for (uint8_t CounterPP = 0; CounterPP < IPFrag_PoolNumber; CounterPP++)
             {
-                if (((((DataPool[CounterPP][2] & 0x1F) << 8) | DataPool[CounterPP][3]) * 8) == (CounterOffset * IPFrag_DataMTUSize))
+                // Fragments of other packets may be in the pool too
+                if (DataPoolSize[CounterPP] &&
+                    (((DataPool[CounterPP][0] >> 16) | DataPool[CounterPP][1]) == ((DataPool[Packet][0] >> 16) | DataPool[Packet][1])) &&
+                    (((((DataPool[CounterPP][2] & 0x1F) << 8) | DataPool[CounterPP][3]) * 8) == (CounterOffset * IPFrag_DataMTUSize)))
                 {
                     memcpy(&(*DataBuff)[CounterOffset * (IPFrag_DataMTUSize - 4)], &DataPool[CounterPP][4], DataPoolSize[CounterPP]);
-                    CounterOffset++;
+                    Crc = IPFrag_CRC32C(Crc, &(*DataBuff)[CounterOffset * (IPFrag_DataMTUSize - 4)], DataPoolSize[CounterPP]);
                     DataPoolSize[CounterPP] = 0;
+                    break;
                 }
             }
-            DataPoolLastPos[CounterPacket] = false;
-            Handler->DataReady = false;
-            return 0;
         }
+        DataPoolLastPos[Packet] = false;
+        Handler->DataReady = IPFrag_PacketReady();
+        if (!IPFrag_CheckCRC(DataBuff, SizeofDataBuff, Crc))
+            return 6;
+        return 0;
+#endif
     }
     return 5;
 }
+/**
+ * @brief  Transmitting pending coalesced messages
+ * @note   Call this function periodically, the shared frame is sent when IPFrag_COALESCE_FlushTime is passed
+ *         If IPFrag_COALESCE_Enable is 0, this function does nothing
+ * @param  Handler:         Pointer of library handler
+ * @retval  0: Successful
+ *          1: ---
+ *          2: ---
+ *          3: Invalid input pointer
+ */
+uint8_t
+IPFrag_TransmitPoll(IPFrag_Handler_t* Handler)
+{
+    if (!Handler) return 3;
+    if (!Handler->TransmitData) return 3;
+    if (!Handler->GetTick) Handler->GetTick = GetTickTemp;
+
+#if IPFrag_COALESCE_Enable == 1
+    if (CoalesceTxSize && ((Handler->GetTick() - CoalesceTxTick) >= IPFrag_COALESCE_FlushTime))
+        IPFrag_CoalesceFlush(Handler);
+#endif
+    return 0;
+}
+/**
+ * @brief  Transmitting pending coalesced messages immediately
+ * @note   If IPFrag_COALESCE_Enable is 0, this function does nothing
+ * @param  Handler:         Pointer of library handler
+ * @retval  0: Successful
+ *          1: ---
+ *          2: ---
+ *          3: Invalid input pointer
+ */
+uint8_t
+IPFrag_TransmitFlush(IPFrag_Handler_t* Handler)
+{
+    if (!Handler) return 3;
+    if (!Handler->TransmitData) return 3;
+
+#if IPFrag_COALESCE_Enable == 1
+    IPFrag_CoalesceFlush(Handler);
+#endif
+    return 0;
+}
+/**
+ * @brief  Time left to transmit pending coalesced messages
+ * @note   Use it to limit waiting of an event loop, so IPFrag_TransmitPoll is called in time
+ * @param  Handler:         Pointer of library handler
+ * @retval Number of ticks left | 0xFFFFFFFF: No pending messages
+ */
+uint32_t
+IPFrag_TransmitTimeout(IPFrag_Handler_t* Handler)
+{
+#if IPFrag_COALESCE_Enable == 1
+    if (!Handler) return 0xFFFFFFFF;
+    if (!CoalesceTxSize) return 0xFFFFFFFF;
+    if (!Handler->GetTick) Handler->GetTick = GetTickTemp;
+
+    uint32_t Elapsed = Handler->GetTick() - CoalesceTxTick;
+    if (Elapsed >= IPFrag_COALESCE_FlushTime) return 0;
+    return IPFrag_COALESCE_FlushTime - Elapsed;
+#else
+    (void)Handler;
+    return 0xFFFFFFFF;
+#endif
+}
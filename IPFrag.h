@@ -47,14 +47,36 @@ extern "C" {
 // Important Notes:
 // 1. Declare IPFrag_Handler_t one struct and fill it before calling any functions
 // 2. The static size would be ((IPFrag_PoolNumber + 1) * (IPFrag_DataMTUSize + 8)) - 8 Bytes
-// 3. Maximum size of a whole packet must be less than or equal to IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4)
+//    If IPFrag_DIRECT_Enable is 1, it would be (2 * IPFrag_DataMTUSize) + (IPFrag_DIRECT_PacketNumber * 32) Bytes at most
+// 3. Maximum size of a whole packet must be less than or equal to IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4), minus 4 Bytes if CRC is enabled
 // 4. This library uses dynamic memory allocation
+// 5. Coalescing must be enabled on both sides, coalesced frames are marked with the reserved flag bit
+// 6. CRC must be enabled on both sides, it adds a 4 Bytes CRC32C trailer to each packet (uses SSE4.2 instructions, checked at run time on GCC/Clang x86 builds,
+//    or ARMv8 CRC instructions if the compiler targets them, e.g. -march=armv8-a+crc)
+// 7. In direct mode, the packet buffer is malloced once, with IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4) Bytes (exact size for simple packets
+//    or if the last fragment is received first), so fragments are never copied again. It is handed to user as is, so it may be larger than the packet
+//    With ReceiveData, each frame is still written to a receive frame and then copied to the packet buffer, so memory traffic is the same as pool mode
+//    and only the static size shrinks. Initialize ReceiveFrame (zero copy) to copy each payload only once, from transport memory to the packet buffer
+// 8. IPFrag_COALESCE_Enable, IPFrag_CRC_Enable and IPFrag_DIRECT_Enable can also be defined by compiler flags (-D)
 #define IPFrag_DataMTUSize             1472         // Must be a factor of 8 | Max number of data in a frame to transfer
-#define IPFrag_PoolNumber              10          // Number of array to save data
+#define IPFrag_PoolNumber              10          // Number of array to save data | Must be less than or equal to 32 in direct mode
 #define IPFrag_USE_MACRO_DELAY         0           // 0: Use handler delay ,So you have to set IPFrag_Delay in Handler | 1: use Macro delay, So you have to set IPFrag_MACRO_DELAY Macro
 // #define IPFrag_MACRO_DELAY(x)                      // If you want to use Macro delay, place your delay function
 #define IPFRAG_Debug_Enable            1           // 0: Disable debug | 1: Enable debug (depends on printf in stdio.h)              
 // #define IPFRAG_Optimization                        // WILL BE ADDED LATER
+#ifndef IPFrag_COALESCE_Enable
+#define IPFrag_COALESCE_Enable         0           // 0: Disable | 1: Pack small messages into shared frames (adds IPFrag_DataMTUSize Bytes to static size, received frames are queued in heap)
+#endif
+#define IPFrag_COALESCE_MessageSize    128         // Messages up to this size are packed | Must be less than or equal to IPFrag_DataMTUSize - 6 (- 4 if CRC is enabled)
+#define IPFrag_COALESCE_FlushSize      (IPFrag_DataMTUSize - 4) // A shared frame is sent when its data reaches this size
+#define IPFrag_COALESCE_FlushTime      10          // A shared frame is sent this number of ticks after its first message | If GetTick is not initialized, messages are not coalesced
+#ifndef IPFrag_CRC_Enable
+#define IPFrag_CRC_Enable              0           // 0: Disable | 1: Check integrity of each received packet with CRC32C
+#endif
+#ifndef IPFrag_DIRECT_Enable
+#define IPFrag_DIRECT_Enable           0           // 0: Keep fragments in pool | 1: Copy each fragment to its final offset in the packet buffer once received
+#endif
+#define IPFrag_DIRECT_PacketNumber     4           // Number of packets being reassembled at the same time in direct mode
 //? ------------------------------------------------------------------------------- //
 
 /**
@@ -75,6 +97,7 @@ typedef struct IPFrag_Handler_s
     uint32_t        (*GetTick)(void);                                       //* Get Tick of program function | Can be initialized
     const uint32_t    ReceiveTimeout;                                       //* Receiving data | Can be defined
     bool              DataReady;                                            //! DO NOT EDIT THIS
+    void            (*ReceiveFrame)(uint8_t ** Data, uint16_t * SizeOfData); //* Zero copy receive function, points Data to a frame kept by transport until the next call | Can be initialized, used instead of ReceiveData in direct mode
 } IPFrag_Handler_t;
 
 /**
@@ -92,6 +115,7 @@ typedef struct IPFrag_Handler_s
  *          1: ---
  *          2: ---
  *          3: Invalid input pointer
+ *          4: Data is larger than IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4) (- 4 if CRC is enabled)
  */
 uint8_t
 IPFrag_TransmitData(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint32_t SizeofDataBuff);
@@ -106,6 +130,7 @@ IPFrag_TransmitData(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint32_t Sizeo
  *  @param  SizeofDataBuff  Pointer of size of data to receive
  *  @param  Timeout         Maximum time to be kept in this function
  *          @note           If user does not initialize delay in handler, this parameters treats as number of tries.
+ *          @note           Packets with CRC error are ignored.
  *  @return 0: Successful
  *          1: Memory error
  *          2: Timeout error
@@ -118,7 +143,7 @@ IPFrag_ReceiveData(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* Size
  *  @note    Call this function when a data received
  *  @param   Handler  Pointer of library handler
  *  @return  0: Successful
- *           1: ---
+ *           1: Memory error
  *           2: ---
  *           3: Invalid input pointer
  *           4: No completed packets
@@ -127,6 +152,8 @@ uint8_t
 IPFrag_CallbackReceive(IPFrag_Handler_t* Handler);
 /**
  *  @brief                  Reading received data
+ *  @note                   Completed packets and coalesced messages are read in the order they were completed,
+ *                          Call it until DataReady is false
  *  @param  Handler         Pointer of library handler
  *  @param  DataBuff        Pointer of pointer of data to receive
  *          @note           In this function pointer of data will be malloced, 
@@ -139,9 +166,41 @@ IPFrag_CallbackReceive(IPFrag_Handler_t* Handler);
  *          3: Invalid input pointer
  *          4: ---
  *          5: Data is not ready to read, recall the function.
+ *          6: CRC error, the packet is ignored
  */
 uint8_t
 IPFrag_ReadReceive(IPFrag_Handler_t* Handler, uint8_t** DataBuff, uint32_t* SizeofDataBuff);
+/**
+ * @brief  Transmitting pending coalesced messages
+ * @note   Call this function periodically, the shared frame is sent when IPFrag_COALESCE_FlushTime is passed
+ *         If IPFrag_COALESCE_Enable is 0, this function does nothing
+ * @param  Handler:         Pointer of library handler
+ * @retval  0: Successful
+ *          1: ---
+ *          2: ---
+ *          3: Invalid input pointer
+ */
+uint8_t
+IPFrag_TransmitPoll(IPFrag_Handler_t* Handler);
+/**
+ * @brief  Transmitting pending coalesced messages immediately
+ * @note   If IPFrag_COALESCE_Enable is 0, this function does nothing
+ * @param  Handler:         Pointer of library handler
+ * @retval  0: Successful
+ *          1: ---
+ *          2: ---
+ *          3: Invalid input pointer
+ */
+uint8_t
+IPFrag_TransmitFlush(IPFrag_Handler_t* Handler);
+/**
+ * @brief  Time left to transmit pending coalesced messages
+ * @note   Use it to limit waiting of an event loop, so IPFrag_TransmitPoll is called in time
+ * @param  Handler:         Pointer of library handler
+ * @retval Number of ticks left | 0xFFFFFFFF: No pending messages
+ */
+uint32_t
+IPFrag_TransmitTimeout(IPFrag_Handler_t* Handler);
 
 #ifdef __cplusplus
 }
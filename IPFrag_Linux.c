@@ -0,0 +1,499 @@
+ /**
+ **********************************************************************************
+ * @file   IPFrag_Linux.c
+ * @author Ali Moallem (https://github.com/AliMoal)
+ * @brief  Linux UDP/TAP transport for IPFrag
+ **********************************************************************************
+ *
+ *! Copyright (c) 2022 Mahda Embedded System (MIT License)
+ *!
+ *! Permission is hereby granted, free of charge, to any person obtaining a copy
+ *! of this software and associated documentation files (the "Software"), to deal
+ *! in the Software without restriction, including without limitation the rights
+ *! to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *! copies of the Software, and to permit persons to whom the Software is
+ *! furnished to do so, subject to the following conditions:
+ *!
+ *! The above copyright notice and this permission notice shall be included in all
+ *! copies or substantial portions of the Software.
+ *!
+ *! THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *! IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *! FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *! AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *! LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *! OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *! SOFTWARE.
+ *!
+ **********************************************************************************
+ **/
+
+#define _GNU_SOURCE // for recvmmsg and sendmmsg
+
+//* Private Includes -------------------------------------------------------------- //
+#include "IPFrag_Linux.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+//* Private Defines and Macros ---------------------------------------------------- //
+#define IPFrag_LINUX_EtherSize      16 // Ethernet header + 2-Byte length of frame
+#define IPFrag_LINUX_FrameSize      (IPFrag_DataMTUSize + IPFrag_LINUX_EtherSize)
+
+/**
+ ** ==================================================================================
+ **                          ##### Private Variables #####
+ ** ==================================================================================
+ **/
+
+static int      LinuxFD = -1;
+static int      LinuxEpoll = -1;
+static uint8_t  LinuxHeaderSize = 0; // Ethernet header of TAP frames
+static bool     LinuxInRun = false;  // ReceiveData only returns frames of the current batch
+
+static uint8_t        RxPool[IPFrag_LINUX_BatchSize][IPFrag_LINUX_FrameSize] = { 0 };
+static uint16_t       RxPoolSize[IPFrag_LINUX_BatchSize] = { 0 }; // 0: Dropped frame
+static struct iovec   RxPoolIO[IPFrag_LINUX_BatchSize];
+static struct mmsghdr RxPoolMsg[IPFrag_LINUX_BatchSize];
+static uint8_t        RxCount = 0;
+static uint8_t        RxPos = 0;
+
+static uint8_t        TxPool[IPFrag_LINUX_BatchSize][IPFrag_LINUX_FrameSize] = { 0 };
+static struct iovec   TxPoolIO[IPFrag_LINUX_BatchSize];
+static struct mmsghdr TxPoolMsg[IPFrag_LINUX_BatchSize];
+static uint8_t        TxCount = 0;
+
+static IPFrag_Linux_Stats_t LinuxStats = { 0 };
+
+/**
+ *! ==================================================================================
+ *!                          ##### Private Functions #####
+ *! ==================================================================================
+ **/
+
+static uint32_t
+LinuxGetTick(void)
+{
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (uint32_t)((Time.tv_sec * 1000) + (Time.tv_nsec / 1000000));
+}
+
+static bool
+LinuxRxPending(void)
+{
+    while ((RxPos < RxCount) && (RxPoolSize[RxPos] == 0))
+        RxPos++;
+    return RxPos < RxCount;
+}
+
+/**
+ * @brief  Receives a batch of frames if the previous one is consumed
+ * @param  Timeout: Maximum time to wait in milliseconds | -1: Forever
+ * @retval 0: Frames are ready | 1: System error | 2: No frames
+ */
+static uint8_t
+LinuxRxFill(int Timeout)
+{
+    if (LinuxRxPending()) return 0;
+
+    struct epoll_event Event;
+    int Result = epoll_wait(LinuxEpoll, &Event, 1, Timeout);
+    if (Result < 0) return (errno == EINTR) ? 2 : 1;
+    if (Result == 0) return 2;
+
+    RxCount = 0;
+    RxPos = 0;
+    if (LinuxHeaderSize) // TAP devices do not support recvmmsg
+    {
+        while (RxCount < IPFrag_LINUX_BatchSize)
+        {
+            ssize_t SizeOfFrame = read(LinuxFD, RxPool[RxCount], IPFrag_LINUX_FrameSize);
+            LinuxStats.RxCalls++;
+            if (SizeOfFrame < 0)
+            {
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) break;
+                return 1;
+            }
+            uint16_t Length = (RxPool[RxCount][14] << 8) | RxPool[RxCount][15];
+            RxPoolSize[RxCount] = 0;
+            if ((SizeOfFrame >= IPFrag_LINUX_EtherSize) &&
+                (((RxPool[RxCount][12] << 8) | RxPool[RxCount][13]) == IPFrag_LINUX_EtherType) &&
+                (Length >= 5) && (Length <= IPFrag_DataMTUSize) &&
+                (Length <= (SizeOfFrame - IPFrag_LINUX_EtherSize))) // Trims Ethernet padding
+                RxPoolSize[RxCount] = Length;
+            RxCount++;
+        }
+    }
+    else
+    {
+        for (uint8_t CounterF = 0; CounterF < IPFrag_LINUX_BatchSize; CounterF++)
+        {
+            RxPoolMsg[CounterF].msg_hdr.msg_flags = 0;
+            RxPoolMsg[CounterF].msg_len = 0;
+        }
+        do
+        {
+            Result = recvmmsg(LinuxFD, RxPoolMsg, IPFrag_LINUX_BatchSize, MSG_DONTWAIT, NULL);
+            LinuxStats.RxCalls++;
+            if ((Result < 0) && (errno == ECONNREFUSED)) // ICMP port unreachable of a sent frame, the error is cleared
+                LinuxStats.Dropped++;
+        } while ((Result < 0) && (errno == ECONNREFUSED));
+        if (Result < 0)
+            return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) ? 2 : 1;
+        for (RxCount = 0; RxCount < Result; RxCount++)
+        {
+            RxPoolSize[RxCount] = 0;
+            if (!(RxPoolMsg[RxCount].msg_hdr.msg_flags & MSG_TRUNC) && (RxPoolMsg[RxCount].msg_len >= 5)) // Larger than IPFrag_DataMTUSize is truncated
+                RxPoolSize[RxCount] = RxPoolMsg[RxCount].msg_len;
+        }
+    }
+
+    for (uint8_t CounterF = 0; CounterF < RxCount; CounterF++)
+    {
+        if (RxPoolSize[CounterF])
+            LinuxStats.RxFrames++;
+        else
+            LinuxStats.Dropped++;
+    }
+    return LinuxRxPending() ? 0 : 2;
+}
+
+/**
+ * @brief  Points to the next received frame without waiting
+ * @retval true: Frame is ready | false: No frames
+ */
+static bool
+LinuxRxNext(uint8_t** Frame, uint16_t* SizeOfFrame)
+{
+    *SizeOfFrame = 0;
+    if (LinuxInRun)
+    {
+        if (!LinuxRxPending()) return false;
+    }
+    else if (LinuxRxFill(0))
+    {
+        return false;
+    }
+
+    *Frame = &RxPool[RxPos][LinuxHeaderSize];
+    *SizeOfFrame = RxPoolSize[RxPos];
+    RxPos++;
+    return true;
+}
+
+static void
+LinuxReceiveData(uint8_t* Data, uint16_t* SizeOfData)
+{
+    uint8_t* Frame = NULL;
+    if (LinuxRxNext(&Frame, SizeOfData))
+        memcpy(Data, Frame, *SizeOfData);
+}
+
+static void
+LinuxReceiveFrame(uint8_t** Data, uint16_t* SizeOfData)
+{
+    LinuxRxNext(Data, SizeOfData);
+}
+
+static void
+LinuxTransmitData(uint8_t* Data, uint16_t SizeOfData)
+{
+    if (TxCount == IPFrag_LINUX_BatchSize)
+        IPFrag_Linux_Flush();
+
+    if (LinuxHeaderSize)
+    {
+        memset(TxPool[TxCount], 0xFF, 6);                           // Destination: Broadcast
+        memcpy(&TxPool[TxCount][6], "\x02\x00\x00\x00\x00\x01", 6); // Source: Locally administered
+        TxPool[TxCount][12] = IPFrag_LINUX_EtherType >> 8;
+        TxPool[TxCount][13] = IPFrag_LINUX_EtherType & 0xFF;
+        TxPool[TxCount][14] = SizeOfData >> 8;
+        TxPool[TxCount][15] = SizeOfData & 0xFF;
+    }
+    memcpy(&TxPool[TxCount][LinuxHeaderSize], Data, SizeOfData);
+    TxPoolIO[TxCount].iov_len = SizeOfData + LinuxHeaderSize;
+    TxCount++;
+}
+
+static uint8_t
+LinuxInit(IPFrag_Handler_t* Handler)
+{
+    LinuxEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (LinuxEpoll < 0) return 1;
+
+    struct epoll_event Event = { 0 };
+    Event.events = EPOLLIN;
+    Event.data.fd = LinuxFD;
+    if (epoll_ctl(LinuxEpoll, EPOLL_CTL_ADD, LinuxFD, &Event) < 0) return 1;
+
+    memset(RxPoolMsg, 0, sizeof(RxPoolMsg));
+    memset(TxPoolMsg, 0, sizeof(TxPoolMsg));
+    for (uint8_t CounterF = 0; CounterF < IPFrag_LINUX_BatchSize; CounterF++)
+    {
+        RxPoolIO[CounterF].iov_base = RxPool[CounterF];
+        RxPoolIO[CounterF].iov_len = IPFrag_DataMTUSize; // Frames are received without header
+        RxPoolMsg[CounterF].msg_hdr.msg_iov = &RxPoolIO[CounterF];
+        RxPoolMsg[CounterF].msg_hdr.msg_iovlen = 1;
+
+        TxPoolIO[CounterF].iov_base = TxPool[CounterF];
+        TxPoolIO[CounterF].iov_len = 0;
+        TxPoolMsg[CounterF].msg_hdr.msg_iov = &TxPoolIO[CounterF];
+        TxPoolMsg[CounterF].msg_hdr.msg_iovlen = 1;
+    }
+    RxCount = 0;
+    RxPos = 0;
+    TxCount = 0;
+    memset(&LinuxStats, 0, sizeof(LinuxStats));
+
+    Handler->TransmitData = LinuxTransmitData;
+    Handler->ReceiveData = LinuxReceiveData;
+    Handler->ReceiveFrame = LinuxReceiveFrame;
+    if (!Handler->GetTick) Handler->GetTick = LinuxGetTick;
+    return 0;
+}
+
+/**
+ ** ==================================================================================
+ **                           ##### Public Functions #####
+ ** ==================================================================================
+ **/
+
+/**
+ * @brief  Opening UDP transport
+ * @param  Handler:         Pointer of library handler
+ * @param  LocalAddress:    IPv4 address to bind | NULL: Any address
+ * @param  LocalPort:       Port to bind
+ * @param  RemoteAddress:   IPv4 address of remote side
+ * @param  RemotePort:      Port of remote side
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Invalid input
+ */
+uint8_t
+IPFrag_Linux_InitUDP(IPFrag_Handler_t* Handler, const char* LocalAddress, uint16_t LocalPort, const char* RemoteAddress, uint16_t RemotePort)
+{
+    if (!Handler) return 3;
+    if (!RemoteAddress) return 3;
+
+    struct sockaddr_in Local = { 0 };
+    struct sockaddr_in Remote = { 0 };
+    Local.sin_family = AF_INET;
+    Local.sin_port = htons(LocalPort);
+    Local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (LocalAddress && (inet_pton(AF_INET, LocalAddress, &Local.sin_addr) != 1)) return 3;
+    Remote.sin_family = AF_INET;
+    Remote.sin_port = htons(RemotePort);
+    if (inet_pton(AF_INET, RemoteAddress, &Remote.sin_addr) != 1) return 3;
+
+    IPFrag_Linux_DeInit();
+    LinuxHeaderSize = 0;
+    LinuxFD = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (LinuxFD < 0) return 1;
+
+#if IPFrag_LINUX_SocketBuffer > 0
+    int SocketBuffer = IPFrag_LINUX_SocketBuffer;
+    setsockopt(LinuxFD, SOL_SOCKET, SO_RCVBUF, &SocketBuffer, sizeof(SocketBuffer));
+    setsockopt(LinuxFD, SOL_SOCKET, SO_SNDBUF, &SocketBuffer, sizeof(SocketBuffer));
+#endif
+
+    if ((bind(LinuxFD, (struct sockaddr*)&Local, sizeof(Local)) < 0) ||
+        (connect(LinuxFD, (struct sockaddr*)&Remote, sizeof(Remote)) < 0) ||
+        LinuxInit(Handler))
+    {
+        int Error = errno;
+        IPFrag_Linux_DeInit();
+        errno = Error;
+        return 1;
+    }
+    return 0;
+}
+/**
+ * @brief  Opening TAP transport
+ * @note   It needs CAP_NET_ADMIN or an existing TAP device owned by user
+ * @param  Handler:         Pointer of library handler
+ * @param  Name:            Name of TAP device
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Invalid input
+ */
+uint8_t
+IPFrag_Linux_InitTAP(IPFrag_Handler_t* Handler, const char* Name)
+{
+    if (!Handler) return 3;
+    if (!Name) return 3;
+    if (strlen(Name) >= IFNAMSIZ) return 3;
+
+    IPFrag_Linux_DeInit();
+    LinuxHeaderSize = IPFrag_LINUX_EtherSize;
+    LinuxFD = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (LinuxFD < 0) return 1;
+
+    struct ifreq Request = { 0 };
+    Request.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(Request.ifr_name, Name, IFNAMSIZ - 1);
+
+    if ((ioctl(LinuxFD, TUNSETIFF, &Request) < 0) ||
+        LinuxInit(Handler))
+    {
+        int Error = errno;
+        IPFrag_Linux_DeInit();
+        errno = Error;
+        return 1;
+    }
+    return 0;
+}
+/**
+ * @brief  Closing transport
+ */
+void
+IPFrag_Linux_DeInit(void)
+{
+    if (LinuxEpoll >= 0) close(LinuxEpoll);
+    if (LinuxFD >= 0) close(LinuxFD);
+    LinuxEpoll = -1;
+    LinuxFD = -1;
+    RxCount = 0;
+    RxPos = 0;
+    TxCount = 0;
+    LinuxInRun = false;
+}
+/**
+ * @brief  Transmitting data and flushing the batch
+ * @param  Handler:         Pointer of library handler
+ * @param  DataBuff:        Pointer of data to transmit
+ * @param  SizeofDataBuff:  Size of data to transmit
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Invalid input
+ *          4: Data is larger than IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4) (- 4 if CRC is enabled)
+ */
+uint8_t
+IPFrag_Linux_Transmit(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint32_t SizeofDataBuff)
+{
+    if (LinuxFD < 0) return 3;
+
+    uint8_t Result = IPFrag_TransmitData(Handler, DataBuff, SizeofDataBuff);
+    if (Result) return Result;
+    return IPFrag_Linux_Flush();
+}
+/**
+ * @brief  Transmitting frames in the batch
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Transport is not opened
+ */
+uint8_t
+IPFrag_Linux_Flush(void)
+{
+    if (LinuxFD < 0) return 3;
+
+    uint8_t Sent = 0;
+    while (Sent < TxCount)
+    {
+        int Result;
+        if (LinuxHeaderSize) // TAP devices do not support sendmmsg
+            Result = (write(LinuxFD, TxPool[Sent], TxPoolIO[Sent].iov_len) < 0) ? -1 : 1;
+        else
+            Result = sendmmsg(LinuxFD, &TxPoolMsg[Sent], TxCount - Sent, 0);
+        LinuxStats.TxCalls++;
+
+        if (Result < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == ECONNREFUSED) // ICMP port unreachable of a previous frame, the error is cleared
+            {
+                LinuxStats.Dropped++;
+                continue;
+            }
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ENOBUFS))
+            {
+                struct pollfd Poll = { .fd = LinuxFD, .events = POLLOUT };
+                poll(&Poll, 1, 10);
+                continue;
+            }
+            LinuxStats.Dropped += TxCount - Sent;
+            TxCount = 0;
+            return 1;
+        }
+        Sent += Result;
+        LinuxStats.TxFrames += Result;
+    }
+    TxCount = 0;
+    return 0;
+}
+/**
+ * @brief  Running one iteration of event loop
+ * @note   Waits for frames with epoll, receives them in a batch and feeds the library
+ *         Waiting is limited to the deadline of pending coalesced messages, which are transmitted at the end of each iteration
+ * @param  Handler:         Pointer of library handler
+ * @param  Receive:         Called for each received packet
+ *         @note            Data is malloced, user should free it itself
+ * @param  Timeout:         Maximum time to wait for frames in milliseconds | -1: Forever
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: Timeout error, no frames received in Timeout
+ *          3: Invalid input
+ */
+uint8_t
+IPFrag_Linux_Run(IPFrag_Handler_t* Handler, void (*Receive)(uint8_t* Data, uint32_t Size), int Timeout)
+{
+    if (!Handler) return 3;
+    if (!Receive) return 3;
+    if (LinuxFD < 0) return 3;
+
+    bool     Shortened = false;
+    uint32_t Deadline = IPFrag_TransmitTimeout(Handler);
+    if ((Deadline != 0xFFFFFFFF) && ((Timeout < 0) || ((uint32_t)Timeout > Deadline)))
+    {
+        Timeout = Deadline; // Wakes up in time to transmit pending coalesced messages
+        Shortened = true;
+    }
+
+    uint8_t Result = LinuxRxFill(Timeout);
+    if (Result == 1) return 1;
+    if (Shortened) Result = 0; // Timeout of user is not elapsed
+
+    LinuxInRun = true;
+    while (LinuxRxPending()) // Library is fed only with frames of this batch
+    {
+        IPFrag_CallbackReceive(Handler);
+        while (Handler->DataReady)
+        {
+            uint8_t* Data = NULL;
+            uint32_t Size = 0;
+            uint8_t  ReadResult = IPFrag_ReadReceive(Handler, &Data, &Size);
+            if (ReadResult == 0)
+                Receive(Data, Size);
+            else if (ReadResult != 6) // CRC error does not stop reading the others
+                break;
+        }
+    }
+    LinuxInRun = false;
+
+    IPFrag_TransmitPoll(Handler);
+    if (IPFrag_Linux_Flush()) return 1;
+    return Result;
+}
+/**
+ * @brief  Reading transport statistics
+ * @param  Stats:           Pointer of statistics to fill
+ */
+void
+IPFrag_Linux_GetStats(IPFrag_Linux_Stats_t* Stats)
+{
+    if (Stats) *Stats = LinuxStats;
+}
@@ -0,0 +1,163 @@
+/**
+ **********************************************************************************
+ * @file   IPFrag_Linux.h
+ * @author Ali Moallem (https://github.com/AliMoal)
+ * @brief  Linux UDP/TAP transport for IPFrag
+ **********************************************************************************
+ *
+ *! Copyright (c) 2022 Mahda Embedded System (MIT License)
+ *!
+ *! Permission is hereby granted, free of charge, to any person obtaining a copy
+ *! of this software and associated documentation files (the "Software"), to deal
+ *! in the Software without restriction, including without limitation the rights
+ *! to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *! copies of the Software, and to permit persons to whom the Software is
+ *! furnished to do so, subject to the following conditions:
+ *!
+ *! The above copyright notice and this permission notice shall be included in all
+ *! copies or substantial portions of the Software.
+ *!
+ *! THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *! IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *! FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *! AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *! LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *! OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *! SOFTWARE.
+ *!
+ **********************************************************************************
+ **/
+
+//* Define to prevent recursive inclusion ---------------------------------------- //
+#ifndef IPFARG_LINUX_H
+#define IPFARG_LINUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//* Includes ---------------------------------------------------------------------- //
+#include "IPFrag.h"
+
+//? User Configurations and Notes ------------------------------------------------- //
+// Important Notes:
+// 1. This transport fills TransmitData, ReceiveData, ReceiveFrame and GetTick (milliseconds) of the handler, Only one transport can be opened at a time
+// 2. Frames are received and transmitted in batches with recvmmsg/sendmmsg (read/write for TAP devices)
+// 3. The static size would be 2 * IPFrag_LINUX_BatchSize * (IPFrag_DataMTUSize + 16) Bytes
+// 4. TAP device must be brought up by user (ip link set <name> up), frames are sent to broadcast with IPFrag_LINUX_EtherType
+//    and a 2-Byte length after EtherType, so Ethernet padding of short frames is trimmed on receive
+// 5. ReceiveData never waits, Inside IPFrag_Linux_Run it only returns frames of the current batch and
+//    outside of it, it polls the socket once | Empty read: SizeOfData = 0
+// 6. IPFrag_Linux_Run shortens its wait to the deadline of pending coalesced message (IPFrag_COALESCE_FlushTime)
+// 7. Frames larger than IPFrag_DataMTUSize and frames refused by remote side (ICMP port unreachable) are counted in Dropped
+#define IPFrag_LINUX_BatchSize         32          // Max number of frames in a recvmmsg/sendmmsg call
+#define IPFrag_LINUX_SocketBuffer      (4 * 1024 * 1024) // Size of UDP socket buffers | 0: Keep system default
+#define IPFrag_LINUX_EtherType         0x88B5      // EtherType of TAP frames (Local Experimental)
+//? ------------------------------------------------------------------------------- //
+
+#if IPFrag_LINUX_BatchSize > 255
+#error "IPFrag_LINUX_BatchSize MUST BE LESS THAN OR EQUAL TO 255"
+#endif
+
+/**
+ ** ==================================================================================
+ **                                ##### Struct #####
+ ** ==================================================================================
+ **/
+/**
+ * @brief  Transport statistics
+ * @note   Frames per call shows how well system calls are batched
+ */
+typedef struct IPFrag_Linux_Stats_s
+{
+    uint64_t        RxFrames;                                               //* Number of received frames
+    uint64_t        RxCalls;                                                //* Number of receiving system calls
+    uint64_t        TxFrames;                                               //* Number of transmitted frames
+    uint64_t        TxCalls;                                                //* Number of transmitting system calls
+    uint64_t        Dropped;                                                //* Number of truncated, short or foreign frames and refused (ICMP) frames
+} IPFrag_Linux_Stats_t;
+
+/**
+ ** ==================================================================================
+ **                            ##### Public Functions #####
+ ** ==================================================================================
+ **/
+/**
+ * @brief  Opening UDP transport
+ * @param  Handler:         Pointer of library handler
+ * @param  LocalAddress:    IPv4 address to bind | NULL: Any address
+ * @param  LocalPort:       Port to bind
+ * @param  RemoteAddress:   IPv4 address of remote side
+ * @param  RemotePort:      Port of remote side
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Invalid input
+ */
+uint8_t
+IPFrag_Linux_InitUDP(IPFrag_Handler_t* Handler, const char* LocalAddress, uint16_t LocalPort, const char* RemoteAddress, uint16_t RemotePort);
+/**
+ * @brief  Opening TAP transport
+ * @note   It needs CAP_NET_ADMIN or an existing TAP device owned by user
+ * @param  Handler:         Pointer of library handler
+ * @param  Name:            Name of TAP device
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Invalid input
+ */
+uint8_t
+IPFrag_Linux_InitTAP(IPFrag_Handler_t* Handler, const char* Name);
+/**
+ * @brief  Closing transport
+ */
+void
+IPFrag_Linux_DeInit(void);
+/**
+ * @brief  Transmitting data and flushing the batch
+ * @param  Handler:         Pointer of library handler
+ * @param  DataBuff:        Pointer of data to transmit
+ * @param  SizeofDataBuff:  Size of data to transmit
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Invalid input
+ *          4: Data is larger than IPFrag_PoolNumber * (IPFrag_DataMTUSize - 4) (- 4 if CRC is enabled)
+ */
+uint8_t
+IPFrag_Linux_Transmit(IPFrag_Handler_t* Handler, uint8_t* DataBuff, uint32_t SizeofDataBuff);
+/**
+ * @brief  Transmitting frames in the batch
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: ---
+ *          3: Transport is not opened
+ */
+uint8_t
+IPFrag_Linux_Flush(void);
+/**
+ * @brief  Running one iteration of event loop
+ * @note   Waits for frames with epoll, receives them in a batch and feeds the library
+ *         Waiting is limited to the deadline of pending coalesced messages, which are transmitted at the end of each iteration
+ * @param  Handler:         Pointer of library handler
+ * @param  Receive:         Called for each received packet
+ *         @note            Data is malloced, user should free it itself
+ * @param  Timeout:         Maximum time to wait for frames in milliseconds | -1: Forever
+ * @retval  0: Successful
+ *          1: System error, check errno
+ *          2: Timeout error, no frames received in Timeout
+ *          3: Invalid input
+ */
+uint8_t
+IPFrag_Linux_Run(IPFrag_Handler_t* Handler, void (*Receive)(uint8_t* Data, uint32_t Size), int Timeout);
+/**
+ * @brief  Reading transport statistics
+ * @param  Stats:           Pointer of statistics to fill
+ */
+void
+IPFrag_Linux_GetStats(IPFrag_Linux_Stats_t* Stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,184 @@
+/**
+ **********************************************************************************
+ * @file   crc_corruption.c
+ * @author Ali Moallem (https://github.com/AliMoal)
+ * @brief  Checks that IPFrag rejects corrupted packets when CRC is enabled
+ **********************************************************************************
+ *
+ *! Copyright (c) 2022 Mahda Embedded System (MIT License)
+ *!
+ *! Permission is hereby granted, free of charge, to any person obtaining a copy
+ *! of this software and associated documentation files (the "Software"), to deal
+ *! in the Software without restriction, including without limitation the rights
+ *! to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *! copies of the Software, and to permit persons to whom the Software is
+ *! furnished to do so, subject to the following conditions:
+ *!
+ *! The above copyright notice and this permission notice shall be included in all
+ *! copies or substantial portions of the Software.
+ *!
+ *! THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *! IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *! FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *! AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *! LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *! OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *! SOFTWARE.
+ *!
+ **********************************************************************************
+ *
+ * Frames are kept in memory, TransmitData flips one bit of one frame in each round
+ * Each round, IPFrag_ReadReceive must return 6 for the message of that frame and
+ * deliver the others intact
+ * Build from the repository root (linux_loopback.sh runs it in CRC configurations):
+ *   gcc -O2 -I. -DIPFrag_CRC_Enable=1 examples/crc_corruption.c IPFrag.c -o crc_corruption
+ **/
+
+//* Includes ---------------------------------------------------------------------- //
+#include "IPFrag.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if IPFrag_CRC_Enable != 1
+#error "Build with -DIPFrag_CRC_Enable=1"
+#endif
+
+//* Defines and Macros ------------------------------------------------------------ //
+#define CORRUPTION_MessageNumber    12
+#define CORRUPTION_FrameNumber      64
+
+static uint8_t   FramePool[CORRUPTION_FrameNumber][IPFrag_DataMTUSize];
+static uint16_t  FramePoolSize[CORRUPTION_FrameNumber];
+static uint8_t   FrameHead = 0;
+static uint8_t   FrameTail = 0;
+static uint8_t   FrameCorrupted = 0xFF;   // Index of frame to corrupt in this round
+static uint32_t  Tick = 0;
+static uint8_t   Message[5000];
+
+static uint32_t
+MessageSize(uint32_t Number)
+{
+    static const uint32_t Sizes[4] = { 20, 90, 700, 4000 }; // Coalesced, coalesced, simple, fragmented
+    return Sizes[Number % 4] + Number;
+}
+
+static void
+MessageFill(uint32_t Number)
+{
+    Message[0] = (uint8_t)Number;
+    for (uint32_t CounterF = 1; CounterF < MessageSize(Number); CounterF++)
+        Message[CounterF] = (uint8_t)((Number * 11) + CounterF);
+}
+
+static void
+TransmitData(uint8_t* Data, uint16_t SizeOfData)
+{
+    memcpy(FramePool[FrameTail], Data, SizeOfData);
+    FramePoolSize[FrameTail] = SizeOfData;
+    if (FrameTail == FrameCorrupted)
+    {
+        // Flips a payload bit, coalesced frames keep their record lengths (bytes 4 and 5) intact
+        uint16_t Position = (((FramePool[FrameTail][2] & 0xE0) == 0xC0) ? 6 : 4) + (FrameTail % 3);
+        FramePool[FrameTail][Position] ^= 0x10;
+    }
+    FrameTail++;
+}
+
+static void
+ReceiveData(uint8_t* Data, uint16_t* SizeOfData)
+{
+    *SizeOfData = 0;
+    if (FrameHead == FrameTail) return;
+    memcpy(Data, FramePool[FrameHead], FramePoolSize[FrameHead]);
+    *SizeOfData = FramePoolSize[FrameHead];
+    FrameHead++;
+}
+
+static uint32_t
+GetTick(void)
+{
+    return Tick;
+}
+
+/**
+ * @brief  Transmits all messages, corrupting one frame, and reads them back
+ * @retval Number of messages rejected with CRC error | 0xFF: Wrong or missing message
+ */
+static uint8_t
+Round(IPFrag_Handler_t* Handler, uint8_t* NumberOfFrames)
+{
+    bool Received[CORRUPTION_MessageNumber] = { 0 };
+    uint8_t Rejected = 0;
+
+    FrameHead = 0;
+    FrameTail = 0;
+    for (uint32_t Number = 0; Number < CORRUPTION_MessageNumber; Number++)
+    {
+        MessageFill(Number);
+        if (IPFrag_TransmitData(Handler, Message, MessageSize(Number))) return 0xFF;
+    }
+    IPFrag_TransmitFlush(Handler);
+    *NumberOfFrames = FrameTail;
+
+    while (FrameHead != FrameTail)
+    {
+        IPFrag_CallbackReceive(Handler);
+        while (Handler->DataReady)
+        {
+            uint8_t* Data = NULL;
+            uint32_t Size = 0;
+            uint8_t  Result = IPFrag_ReadReceive(Handler, &Data, &Size);
+            if (Result == 6)
+            {
+                Rejected++;
+                continue;
+            }
+            if (Result) break;
+
+            uint32_t Number = Data[0];
+            bool Valid = (Number < CORRUPTION_MessageNumber) && !Received[Number] && (Size == MessageSize(Number));
+            for (uint32_t CounterF = 1; Valid && (CounterF < Size); CounterF++)
+                Valid = Data[CounterF] == (uint8_t)((Number * 11) + CounterF);
+            free(Data);
+            if (!Valid) return 0xFF;
+            Received[Number] = true;
+        }
+    }
+
+    uint8_t Missing = 0;
+    for (uint32_t Number = 0; Number < CORRUPTION_MessageNumber; Number++)
+        Missing += !Received[Number];
+    if (Missing != Rejected) return 0xFF;
+    return Rejected;
+}
+
+int
+main(void)
+{
+    IPFrag_Handler_t Handler = { .TransmitData = TransmitData, .ReceiveData = ReceiveData, .GetTick = GetTick, .ReceiveTimeout = 1000 };
+
+    printf("Config: COALESCE=%d CRC=%d DIRECT=%d\n", IPFrag_COALESCE_Enable, IPFrag_CRC_Enable, IPFrag_DIRECT_Enable);
+
+    uint8_t NumberOfFrames = 0;
+    FrameCorrupted = 0xFF;
+    if (Round(&Handler, &NumberOfFrames) != 0)
+    {
+        printf("FAIL: clean round\n");
+        return 1;
+    }
+
+    for (FrameCorrupted = 0; FrameCorrupted < NumberOfFrames; FrameCorrupted++)
+    {
+        uint8_t Frames = 0;
+        uint8_t Rejected = Round(&Handler, &Frames);
+        if (Rejected != 1)
+        {
+            printf("FAIL: frame %u of %u corrupted, %s\n", FrameCorrupted, NumberOfFrames,
+                   (Rejected == 0xFF) ? "wrong or missing message" : "CRC error is not reported once");
+            return 1;
+        }
+    }
+    printf("Each of %u frames corrupted in turn, the packet was rejected with CRC error (6) every time\n", NumberOfFrames);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ **********************************************************************************
+ * @file   linux_loopback.c
+ * @author Ali Moallem (https://github.com/AliMoal)
+ * @brief  Loopback benchmark of IPFrag Linux transport
+ **********************************************************************************
+ *
+ *! Copyright (c) 2022 Mahda Embedded System (MIT License)
+ *!
+ *! Permission is hereby granted, free of charge, to any person obtaining a copy
+ *! of this software and associated documentation files (the "Software"), to deal
+ *! in the Software without restriction, including without limitation the rights
+ *! to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *! copies of the Software, and to permit persons to whom the Software is
+ *! furnished to do so, subject to the following conditions:
+ *!
+ *! The above copyright notice and this permission notice shall be included in all
+ *! copies or substantial portions of the Software.
+ *!
+ *! THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *! IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *! FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *! AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *! LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *! OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *! SOFTWARE.
+ *!
+ **********************************************************************************
+ *
+ * Sends a mix of small and large messages to itself over a UDP loopback socket,
+ * checks every received message and prints transport statistics
+ * Build from the repository root (see linux_loopback.sh to run all configurations):
+ *   gcc -O2 -I. -DIPFrag_COALESCE_Enable=1 examples/linux_loopback.c IPFrag.c IPFrag_Linux.c -o linux_loopback
+ * Usage: linux_loopback [NumberOfMessages] [Port]
+ **/
+
+#define _GNU_SOURCE // for clock_gettime
+
+//* Includes ---------------------------------------------------------------------- //
+#include "IPFrag_Linux.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+//* Defines and Macros ------------------------------------------------------------ //
+#define LOOPBACK_BurstSize      8           // Messages transmitted between two receives
+#define LOOPBACK_LargeSize      12000       // Max size of large messages
+#define LOOPBACK_SmallSize      100         // Max size of small messages
+
+static uint32_t  MessageNumber = 20000;
+static uint8_t*  MessageDone = NULL;
+static uint32_t  Received = 0;
+static uint32_t  Corrupted = 0;
+static uint8_t   Message[LOOPBACK_LargeSize];
+
+static uint32_t
+MessageSize(uint32_t Number)
+{
+    if (Number % 4) // 3 of 4 messages are small, so they can be coalesced
+        return 8 + (Number % LOOPBACK_SmallSize);
+    return 1000 + ((Number * 37) % (LOOPBACK_LargeSize - 1000));
+}
+
+static void
+MessageFill(uint32_t Number)
+{
+    uint32_t Size = MessageSize(Number);
+    memcpy(Message, &Number, 4);
+    for (uint32_t CounterF = 4; CounterF < Size; CounterF++)
+        Message[CounterF] = (uint8_t)((Number * 7) + CounterF);
+}
+
+static void
+MessageReceive(uint8_t* Data, uint32_t Size)
+{
+    uint32_t Number = 0xFFFFFFFF;
+    if (Size >= 4) memcpy(&Number, Data, 4);
+
+    if ((Number >= MessageNumber) || (Size != MessageSize(Number)) || MessageDone[Number])
+    {
+        Corrupted++;
+        free(Data);
+        return;
+    }
+    for (uint32_t CounterF = 4; CounterF < Size; CounterF++)
+    {
+        if (Data[CounterF] != (uint8_t)((Number * 7) + CounterF))
+        {
+            Corrupted++;
+            free(Data);
+            return;
+        }
+    }
+    MessageDone[Number] = 1;
+    Received++;
+    free(Data);
+}
+
+static double
+TimeNow(void)
+{
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return Time.tv_sec + (Time.tv_nsec / 1e9);
+}
+
+int
+main(int argc, char** argv)
+{
+    uint16_t Port = 45123;
+    if (argc > 1) MessageNumber = (uint32_t)strtoul(argv[1], NULL, 0);
+    if (argc > 2) Port = (uint16_t)strtoul(argv[2], NULL, 0);
+    MessageDone = calloc(MessageNumber, 1);
+    if (!MessageDone) return 1;
+
+    printf("Config: COALESCE=%d CRC=%d DIRECT=%d MTU=%d Messages=%u\n",
+           IPFrag_COALESCE_Enable, IPFrag_CRC_Enable, IPFrag_DIRECT_Enable, IPFrag_DataMTUSize, MessageNumber);
+
+    IPFrag_Handler_t Handler = { .ReceiveTimeout = 1000 };
+    if (IPFrag_Linux_InitUDP(&Handler, "127.0.0.1", Port, "127.0.0.1", Port))
+    {
+        perror("IPFrag_Linux_InitUDP");
+        return 1;
+    }
+
+    // Nothing is received yet, so Run must return at once
+    double Start = TimeNow();
+    uint8_t Result = IPFrag_Linux_Run(&Handler, MessageReceive, 0);
+    if ((Result != 2) || ((TimeNow() - Start) > 0.1))
+    {
+        printf("FAIL: IPFrag_Linux_Run with no frames returned %u after %.3f s\n", Result, TimeNow() - Start);
+        return 1;
+    }
+
+    Start = TimeNow();
+    for (uint32_t Number = 0; Number < MessageNumber; Number++)
+    {
+        MessageFill(Number);
+        Result = IPFrag_TransmitData(&Handler, Message, MessageSize(Number));
+        if (Result)
+        {
+            printf("FAIL: IPFrag_TransmitData returned %u\n", Result);
+            return 1;
+        }
+        if ((Number % LOOPBACK_BurstSize) == (LOOPBACK_BurstSize - 1))
+        {
+            if (IPFrag_Linux_Flush()) perror("IPFrag_Linux_Flush");
+            while (IPFrag_Linux_Run(&Handler, MessageReceive, 0) == 0);
+        }
+    }
+    // Pending coalesced messages are transmitted by Run when their deadline is reached
+    while (IPFrag_Linux_Run(&Handler, MessageReceive, 50) == 0);
+    double Elapsed = TimeNow() - Start;
+
+    IPFrag_Linux_Stats_t Stats;
+    IPFrag_Linux_GetStats(&Stats);
+    IPFrag_Linux_DeInit();
+    free(MessageDone);
+
+    printf("Received:  %u/%u messages, %u corrupted, %.3f s, %.0f messages/s\n",
+           Received, MessageNumber, Corrupted, Elapsed, Received / Elapsed);
+    printf("RX:        %llu frames in %llu calls (%.1f frames/call)\n",
+           (unsigned long long)Stats.RxFrames, (unsigned long long)Stats.RxCalls,
+           Stats.RxCalls ? (double)Stats.RxFrames / Stats.RxCalls : 0.0);
+    printf("TX:        %llu frames in %llu calls (%.1f frames/call)\n",
+           (unsigned long long)Stats.TxFrames, (unsigned long long)Stats.TxCalls,
+           Stats.TxCalls ? (double)Stats.TxFrames / Stats.TxCalls : 0.0);
+    printf("Dropped:   %llu frames\n", (unsigned long long)Stats.Dropped);
+
+    if ((Received != MessageNumber) || Corrupted)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Builds and runs examples/linux_loopback.c in each configuration of the library,
+# and examples/crc_corruption.c in configurations with CRC
+# If it runs as root, examples/linux_tap.c tests TAP transport in each configuration too
+# Usage: examples/linux_loopback.sh [NumberOfMessages]
+set -e
+cd "$(dirname "$0")/.."
+OUT="${TMPDIR:-/tmp}/ipfrag_linux_loopback"
+STATUS=0
+for CONFIG in \
+    "" \
+    "-DIPFrag_COALESCE_Enable=1" \
+    "-DIPFrag_CRC_Enable=1" \
+    "-DIPFrag_DIRECT_Enable=1" \
+    "-DIPFrag_COALESCE_Enable=1 -DIPFrag_CRC_Enable=1 -DIPFrag_DIRECT_Enable=1"
+do
+    ${CC:-gcc} -O2 -I. $CONFIG examples/linux_loopback.c IPFrag.c IPFrag_Linux.c -o "$OUT"
+    "$OUT" "$@" || STATUS=1
+    case "$CONFIG" in *CRC*)
+        ${CC:-gcc} -O2 -I. $CONFIG examples/crc_corruption.c IPFrag.c -o "$OUT"
+        "$OUT" || STATUS=1
+    esac
+    if [ "$(id -u)" = 0 ] && [ -c /dev/net/tun ]; then
+        ${CC:-gcc} -O2 -I. $CONFIG examples/linux_tap.c IPFrag.c IPFrag_Linux.c -o "$OUT"
+        "$OUT" || STATUS=1
+    else
+        echo "TAP test is skipped, it needs root"
+    fi
+    echo
+done
+rm -f "$OUT"
+exit $STATUS
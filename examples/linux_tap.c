@@ -0,0 +1,228 @@
+/**
+ **********************************************************************************
+ * @file   linux_tap.c
+ * @author Ali Moallem (https://github.com/AliMoal)
+ * @brief  TAP test of IPFrag Linux transport
+ **********************************************************************************
+ *
+ *! Copyright (c) 2022 Mahda Embedded System (MIT License)
+ *!
+ *! Permission is hereby granted, free of charge, to any person obtaining a copy
+ *! of this software and associated documentation files (the "Software"), to deal
+ *! in the Software without restriction, including without limitation the rights
+ *! to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *! copies of the Software, and to permit persons to whom the Software is
+ *! furnished to do so, subject to the following conditions:
+ *!
+ *! The above copyright notice and this permission notice shall be included in all
+ *! copies or substantial portions of the Software.
+ *!
+ *! THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *! IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *! FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *! AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *! LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *! OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *! SOFTWARE.
+ *!
+ **********************************************************************************
+ *
+ * Opens a TAP device with IPFrag_Linux_InitTAP and echoes every transmitted frame
+ * back into it from a packet socket, padded to the minimum Ethernet frame (60 Bytes)
+ * like a real link would do. Received messages are checked, so the TAP read/write
+ * paths and trimming of padding are exercised. It needs root (CAP_NET_ADMIN)
+ * Build from the repository root (linux_loopback.sh runs it when it runs as root):
+ *   gcc -O2 -I. examples/linux_tap.c IPFrag.c IPFrag_Linux.c -o linux_tap
+ * Usage: linux_tap [NumberOfMessages] [TAPName]
+ **/
+
+#define _GNU_SOURCE // for clock_gettime
+
+//* Includes ---------------------------------------------------------------------- //
+#include "IPFrag_Linux.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/if.h>
+#include <linux/if_packet.h>
+
+//* Defines and Macros ------------------------------------------------------------ //
+#define TAP_MinimumFrame        60          // Ethernet frame without FCS
+#define TAP_LargeSize           6000        // Max size of large messages
+
+static uint32_t  MessageNumber = 500;
+static uint8_t*  MessageDone = NULL;
+static uint32_t  Received = 0;
+static uint32_t  Corrupted = 0;
+static uint8_t   Message[TAP_LargeSize];
+
+static uint32_t
+MessageSize(uint32_t Number)
+{
+    if (Number % 2) // Short messages are padded by the link
+        return 4 + (Number % 40);
+    return 100 + ((Number * 53) % (TAP_LargeSize - 100));
+}
+
+static void
+MessageFill(uint32_t Number)
+{
+    uint32_t Size = MessageSize(Number);
+    memcpy(Message, &Number, 4);
+    for (uint32_t CounterF = 4; CounterF < Size; CounterF++)
+        Message[CounterF] = (uint8_t)((Number * 3) + CounterF);
+}
+
+static void
+MessageReceive(uint8_t* Data, uint32_t Size)
+{
+    uint32_t Number = 0xFFFFFFFF;
+    if (Size >= 4) memcpy(&Number, Data, 4);
+
+    bool Valid = (Number < MessageNumber) && (Size == MessageSize(Number)) && !MessageDone[Number];
+    for (uint32_t CounterF = 4; Valid && (CounterF < Size); CounterF++)
+        Valid = Data[CounterF] == (uint8_t)((Number * 3) + CounterF);
+    free(Data);
+
+    if (!Valid)
+    {
+        Corrupted++;
+        return;
+    }
+    MessageDone[Number] = 1;
+    Received++;
+}
+
+/**
+ * @brief  Sends frames transmitted by the transport back to it
+ * @retval Number of echoed frames
+ */
+static uint32_t
+Echo(int Socket)
+{
+    uint8_t  Frame[IPFrag_DataMTUSize + 16 + TAP_MinimumFrame];
+    uint32_t Echoed = 0;
+    while (1)
+    {
+        struct sockaddr_ll From;
+        socklen_t SizeOfFrom = sizeof(From);
+        ssize_t SizeOfFrame = recvfrom(Socket, Frame, sizeof(Frame) - TAP_MinimumFrame, MSG_DONTWAIT, (struct sockaddr*)&From, &SizeOfFrom);
+        if (SizeOfFrame < 0) break;
+        if (From.sll_pkttype == PACKET_OUTGOING) continue; // Our own echo
+
+        if (SizeOfFrame < TAP_MinimumFrame)
+        {
+            memset(&Frame[SizeOfFrame], 0xA5, TAP_MinimumFrame - SizeOfFrame);
+            SizeOfFrame = TAP_MinimumFrame;
+        }
+        if (send(Socket, Frame, SizeOfFrame, 0) == SizeOfFrame)
+            Echoed++;
+    }
+    return Echoed;
+}
+
+static double
+TimeNow(void)
+{
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return Time.tv_sec + (Time.tv_nsec / 1e9);
+}
+
+int
+main(int argc, char** argv)
+{
+    const char* Name = "ipfrag0";
+    if (argc > 1) MessageNumber = (uint32_t)strtoul(argv[1], NULL, 0);
+    if (argc > 2) Name = argv[2];
+    MessageDone = calloc(MessageNumber, 1);
+    if (!MessageDone) return 1;
+
+    printf("Config: COALESCE=%d CRC=%d DIRECT=%d TAP=%s Messages=%u\n",
+           IPFrag_COALESCE_Enable, IPFrag_CRC_Enable, IPFrag_DIRECT_Enable, Name, MessageNumber);
+
+    IPFrag_Handler_t Handler = { .ReceiveTimeout = 1000 };
+    if (IPFrag_Linux_InitTAP(&Handler, Name))
+    {
+        perror("IPFrag_Linux_InitTAP");
+        return 1;
+    }
+
+    struct ifreq Request = { 0 };
+    strncpy(Request.ifr_name, Name, IFNAMSIZ - 1);
+    int Control = socket(AF_INET, SOCK_DGRAM, 0);
+    int Socket = socket(AF_PACKET, SOCK_RAW, htons(IPFrag_LINUX_EtherType));
+    if ((Control < 0) || (Socket < 0) || (ioctl(Control, SIOCGIFFLAGS, &Request) < 0))
+    {
+        perror("socket");
+        return 1;
+    }
+    Request.ifr_flags |= IFF_UP;
+    if ((ioctl(Control, SIOCSIFFLAGS, &Request) < 0) || (ioctl(Control, SIOCGIFINDEX, &Request) < 0))
+    {
+        perror("ioctl");
+        return 1;
+    }
+    struct sockaddr_ll Link = { 0 };
+    Link.sll_family = AF_PACKET;
+    Link.sll_protocol = htons(IPFrag_LINUX_EtherType);
+    Link.sll_ifindex = Request.ifr_ifindex;
+    if (bind(Socket, (struct sockaddr*)&Link, sizeof(Link)) < 0)
+    {
+        perror("bind");
+        return 1;
+    }
+
+    double   Start = TimeNow();
+    uint32_t Echoed = 0;
+    for (uint32_t Number = 0; Number < MessageNumber; Number++)
+    {
+        MessageFill(Number);
+        uint8_t Result = IPFrag_Linux_Transmit(&Handler, Message, MessageSize(Number));
+        if (Result)
+        {
+            printf("FAIL: IPFrag_Linux_Transmit returned %u\n", Result);
+            return 1;
+        }
+        Echoed += Echo(Socket);
+        while (IPFrag_Linux_Run(&Handler, MessageReceive, 0) == 0);
+    }
+    // Pending coalesced messages are transmitted by Run when their deadline is reached
+    while ((Received + Corrupted) < MessageNumber)
+    {
+        Echoed += Echo(Socket);
+        uint8_t Result = IPFrag_Linux_Run(&Handler, MessageReceive, 50);
+        if ((Result == 2) && !Echo(Socket) && ((TimeNow() - Start) > 5)) break;
+        if (Result == 1)
+        {
+            perror("IPFrag_Linux_Run");
+            break;
+        }
+    }
+    double Elapsed = TimeNow() - Start;
+
+    IPFrag_Linux_Stats_t Stats;
+    IPFrag_Linux_GetStats(&Stats);
+    IPFrag_Linux_DeInit();
+    close(Socket);
+    close(Control);
+    free(MessageDone);
+
+    printf("Received:  %u/%u messages, %u corrupted, %u frames echoed, %.3f s\n",
+           Received, MessageNumber, Corrupted, Echoed, Elapsed);
+    printf("RX:        %llu frames in %llu calls, TX: %llu frames in %llu calls, Dropped: %llu frames\n",
+           (unsigned long long)Stats.RxFrames, (unsigned long long)Stats.RxCalls,
+           (unsigned long long)Stats.TxFrames, (unsigned long long)Stats.TxCalls, (unsigned long long)Stats.Dropped);
+
+    if ((Received != MessageNumber) || Corrupted)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}